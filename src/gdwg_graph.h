@@ -3,16 +3,51 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <cmath>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <ostream>
+#include <queue>
+#include <random>
+#include <ranges>
 #include <set>
+#include <shared_mutex>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 namespace std {
 	template<typename T1, typename T2>
 	struct hash<std::pair<T1, T2>> {
@@ -24,6 +59,123 @@ namespace std {
 	};
 } // namespace std
 namespace gdwg {
+	class thread_pool;
+	template<typename N, typename E>
+	class graph;
+	namespace detail {
+		struct graph_access;
+		// Types graph::save_binary can store.
+		template<typename T>
+		concept binary_value = std::is_arithmetic_v<T> or std::is_same_v<T, std::string>;
+		template<typename N, typename E>
+		auto save_binary(const graph<N, E>& g, const std::string& path) -> void;
+		template<typename F>
+		auto parallel_for(thread_pool* pool, std::size_t count, std::size_t threads, F fn) -> void;
+		template<typename F>
+		auto parallel_for(std::size_t count, std::size_t threads, F fn) -> void;
+	} // namespace detail
+	// Selects the overloads of whole-graph operations that split their per-source work across threads. The
+	// results are identical to the serial operations.
+	struct parallel_policy {
+		// 0 means one worker per hardware thread.
+		std::size_t threads = 0;
+		// The pool to run on; null means the current pool (see pool_scope).
+		thread_pool* pool = nullptr;
+	};
+	inline constexpr auto par = parallel_policy{};
+	// A lazily evaluated, single-pass range backed by a coroutine. Values are produced only as the range is
+	// iterated, and destroying the generator early abandons the rest of the work. Reference types are yielded
+	// without copying, so a generator<const N&> over a graph is valid only while the graph is unchanged.
+	template<typename T>
+	class generator : public std::ranges::view_base {
+	 public:
+		using value_type = std::remove_cvref_t<T>;
+		using reference = std::conditional_t<std::is_reference_v<T>, T, const T&>;
+		struct promise_type {
+			const std::remove_reference_t<T>* current = nullptr;
+			std::exception_ptr error;
+			auto get_return_object() -> generator {
+				return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+			auto initial_suspend() noexcept -> std::suspend_always {
+				return {};
+			}
+			auto final_suspend() noexcept -> std::suspend_always {
+				return {};
+			}
+			// A yielded temporary lives until the coroutine resumes, so pointing at it is safe.
+			auto yield_value(const std::remove_reference_t<T>& value) noexcept -> std::suspend_always {
+				current = std::addressof(value);
+				return {};
+			}
+			auto return_void() noexcept -> void {}
+			auto unhandled_exception() noexcept -> void {
+				error = std::current_exception();
+			}
+		};
+		class iterator {
+		 public:
+			using value_type = generator::value_type;
+			using difference_type = std::ptrdiff_t;
+			iterator() = default;
+			auto operator*() const -> reference {
+				return static_cast<reference>(*handle_.promise().current);
+			}
+			auto operator++() -> iterator& {
+				advance(handle_);
+				return *this;
+			}
+			auto operator++(int) -> void {
+				++*this;
+			}
+			friend auto operator==(const iterator& it, std::default_sentinel_t) noexcept -> bool {
+				return it.handle_ == nullptr or it.handle_.done();
+			}
+
+		 private:
+			friend class generator;
+			std::coroutine_handle<promise_type> handle_;
+			explicit iterator(std::coroutine_handle<promise_type> handle)
+			: handle_(handle) {}
+		};
+
+		generator(generator&& other) noexcept
+		: handle_(std::exchange(other.handle_, nullptr)) {}
+		auto operator=(generator&& other) noexcept -> generator& {
+			if (this != &other) {
+				destroy();
+				handle_ = std::exchange(other.handle_, nullptr);
+			}
+			return *this;
+		}
+		~generator() {
+			destroy();
+		}
+		// Runs the coroutine to its first value; call once.
+		auto begin() -> iterator {
+			advance(handle_);
+			return iterator(handle_);
+		}
+		auto end() noexcept -> std::default_sentinel_t {
+			return std::default_sentinel;
+		}
+
+	 private:
+		std::coroutine_handle<promise_type> handle_;
+		explicit generator(std::coroutine_handle<promise_type> handle)
+		: handle_(handle) {}
+		static auto advance(std::coroutine_handle<promise_type> handle) -> void {
+			handle.resume();
+			if (handle.promise().error) {
+				std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+			}
+		}
+		auto destroy() noexcept -> void {
+			if (handle_) {
+				handle_.destroy();
+			}
+		}
+	};
 	template<typename N, typename E>
 	class graph;
 	template<typename N, typename E>
@@ -106,9 +258,17 @@ namespace gdwg {
 	class graph {
 	 private:
 		struct shared_ptr_less {
+			// Lets nodes_ and edges_ be searched by value without building a shared_ptr.
+			using is_transparent = void;
 			auto operator()(const std::shared_ptr<N>& lhs, const std::shared_ptr<N>& rhs) const -> bool {
 				return *lhs < *rhs;
 			}
+			auto operator()(const std::shared_ptr<N>& lhs, const N& rhs) const -> bool {
+				return *lhs < rhs;
+			}
+			auto operator()(const N& lhs, const std::shared_ptr<N>& rhs) const -> bool {
+				return lhs < *rhs;
+			}
 		};
 		struct pair_less {
 			auto operator()(const std::pair<std::shared_ptr<N>, std::optional<E>>& lhs,
@@ -118,6 +278,14 @@ namespace gdwg {
 				}
 				return lhs.second < rhs.second;
 			}
+			// Searching an edge set by destination alone finds the range of edges to it, whatever their weights.
+			using is_transparent = void;
+			auto operator()(const std::pair<std::shared_ptr<N>, std::optional<E>>& lhs, const N& rhs) const -> bool {
+				return *lhs.first < rhs;
+			}
+			auto operator()(const N& lhs, const std::pair<std::shared_ptr<N>, std::optional<E>>& rhs) const -> bool {
+				return lhs < *rhs.first;
+			}
 		};
 		class my_iterator {
 			using inner_iterator =
@@ -200,6 +368,54 @@ namespace gdwg {
 
 	 public:
 		using iterator = typename graph<N, E>::my_iterator;
+		// A recorded sequence of modifications for apply_batch. Recording does not look at any graph.
+		class batch {
+		 public:
+			auto insert_node(const N& value) -> batch& {
+				ops_.push_back({op_kind::insert_node, value, std::nullopt, std::nullopt});
+				return *this;
+			}
+			auto insert_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> batch& {
+				ops_.push_back({op_kind::insert_edge, src, dst, std::move(weight)});
+				return *this;
+			}
+			auto erase_node(const N& value) -> batch& {
+				ops_.push_back({op_kind::erase_node, value, std::nullopt, std::nullopt});
+				return *this;
+			}
+			auto erase_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> batch& {
+				ops_.push_back({op_kind::erase_edge, src, dst, std::move(weight)});
+				return *this;
+			}
+			auto replace_node(const N& old_data, const N& new_data) -> batch& {
+				ops_.push_back({op_kind::replace_node, old_data, new_data, std::nullopt});
+				return *this;
+			}
+			auto merge_replace_node(const N& old_data, const N& new_data) -> batch& {
+				ops_.push_back({op_kind::merge_replace_node, old_data, new_data, std::nullopt});
+				return *this;
+			}
+			[[nodiscard]] auto size() const noexcept -> std::size_t {
+				return ops_.size();
+			}
+			[[nodiscard]] auto empty() const noexcept -> bool {
+				return ops_.empty();
+			}
+			auto clear() noexcept -> void {
+				ops_.clear();
+			}
+
+		 private:
+			enum class op_kind { insert_node, insert_edge, erase_node, erase_edge, replace_node, merge_replace_node };
+			struct operation {
+				op_kind kind;
+				N first;
+				std::optional<N> second;
+				std::optional<E> weight;
+			};
+			std::vector<operation> ops_;
+			friend class graph<N, E>;
+		};
 		graph() = default;
 		graph(graph&& other) noexcept {
 			nodes_ = std::move(other.nodes_);
@@ -219,6 +435,32 @@ namespace gdwg {
 				}
 			}
 		}
+		// Copies each source's edge set on its own worker, then links the copies into the new trees in order.
+		graph(const parallel_policy& policy, const graph& other) {
+			auto copies = std::vector<std::shared_ptr<N>>{};
+			auto index = std::unordered_map<const N*, std::size_t>{};
+			copies.reserve(other.nodes_.size());
+			index.reserve(other.nodes_.size());
+			for (const auto& node : other.nodes_) {
+				index.emplace(node.get(), copies.size());
+				copies.push_back(std::make_shared<N>(*node));
+			}
+			const auto sources = entries(other.edges_);
+			auto sets = std::vector<typename decltype(edges_)::mapped_type>(sources.size());
+			detail::parallel_for(policy.pool, sources.size(), policy.threads, [&](std::size_t, std::size_t i) {
+				for (const auto& [dst, weight] : sources[i]->second) {
+					sets[i].emplace_hint(sets[i].end(), copies[index.at(dst.get())], weight);
+				}
+			});
+			for (const auto& copy : copies) {
+				nodes_.emplace_hint(nodes_.end(), copy);
+			}
+			for (auto i = std::size_t{0}; i < sources.size(); ++i) {
+				if (not sets[i].empty()) {
+					edges_.emplace_hint(edges_.end(), copies[index.at(sources[i]->first.get())], std::move(sets[i]));
+				}
+			}
+		}
 		graph(std::initializer_list<N> il)
 		: graph(il.begin(), il.end()) {}
 		template<typename InputIt>
@@ -258,10 +500,8 @@ namespace gdwg {
 			edges_.clear();
 		}
 		auto insert_node(const N& value) noexcept -> bool {
-			for (const auto& node : nodes_) {
-				if (*node == value) {
-					return false;
-				}
+			if (nodes_.find(value) != nodes_.end()) {
+				return false;
 			}
 			return nodes_.emplace(std::make_shared<N>(value)).second;
 		}
@@ -294,21 +534,49 @@ namespace gdwg {
 			return res;
 		}
 		[[nodiscard]] auto is_connected(const N& src, const N& dst) const -> bool {
-			const auto src_sp = find_node(src);
-			const auto dst_sp = find_node(dst);
-			if (not is_node(src) or not is_node(dst)) {
+			if (not nodes_.contains(src) or not nodes_.contains(dst)) {
 				throw std::runtime_error("Cannot call gdwg::graph<N, E>::is_connected if src or dst node don't exist "
 				                         "in the graph");
 			}
-			const auto src_it = edges_.find(src_sp);
-			if (src_it != edges_.end()) {
-				for (const auto& edge : src_it->second) {
-					if (*edge.first == dst) {
-						return true;
-					}
+			const auto src_it = edges_.find(src);
+			return src_it != edges_.end() and src_it->second.contains(dst);
+		}
+		// Answers is_connected for every (src, dst) query. Queries are grouped by source so each distinct source's
+		// edge set is looked up once, and the groups are answered on up to `threads` workers (0 means one per
+		// hardware thread).
+		[[nodiscard]] auto is_connected_batch(std::span<const std::pair<N, N>> queries, std::size_t threads = 0) const
+		    -> std::vector<bool> {
+			auto order = std::vector<std::size_t>(queries.size());
+			std::iota(order.begin(), order.end(), std::size_t{0});
+			std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+				return queries[lhs].first < queries[rhs].first;
+			});
+			auto groups = std::vector<std::size_t>{};
+			for (auto i = std::size_t{0}; i < order.size(); ++i) {
+				if (i == 0 or queries[order[i - 1]].first != queries[order[i]].first) {
+					groups.push_back(i);
 				}
 			}
-			return false;
+			groups.push_back(order.size());
+			// One byte per answer, since neighbouring std::vector<bool> elements cannot be written concurrently.
+			auto answers = std::vector<std::uint8_t>(queries.size(), 0);
+			detail::parallel_for(groups.size() - 1, threads, [&](std::size_t, std::size_t group) {
+				const auto& src = queries[order[groups[group]]].first;
+				if (not nodes_.contains(src)) {
+					throw std::runtime_error("Cannot call gdwg::graph<N, E>::is_connected_batch if src or dst node "
+					                         "don't exist in the graph");
+				}
+				const auto src_it = edges_.find(src);
+				for (auto i = groups[group]; i < groups[group + 1]; ++i) {
+					const auto& dst = queries[order[i]].second;
+					if (not nodes_.contains(dst)) {
+						throw std::runtime_error("Cannot call gdwg::graph<N, E>::is_connected_batch if src or dst node "
+						                         "don't exist in the graph");
+					}
+					answers[order[i]] = src_it != edges_.end() and src_it->second.contains(dst);
+				}
+			});
+			return std::vector<bool>(answers.begin(), answers.end());
 		}
 		[[nodiscard]] auto edges(const N& src, const N& dst) const -> std::vector<std::unique_ptr<edge<N, E>>> {
 			const auto src_sp = find_node(src);
@@ -369,6 +637,30 @@ namespace gdwg {
 			}
 			return res;
 		}
+		// Nodes reachable from src in breadth-first order, src first, produced one at a time.
+		[[nodiscard]] auto bfs_range(const N& src) const -> generator<const N&> {
+			const auto it = nodes_.find(src);
+			if (it == nodes_.end()) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::bfs_range if src doesn't exist in the graph");
+			}
+			return bfs_from(*it);
+		}
+		// Nodes reachable from src in depth-first preorder, following edges in the usual edge order.
+		[[nodiscard]] auto dfs_range(const N& src) const -> generator<const N&> {
+			const auto it = nodes_.find(src);
+			if (it == nodes_.end()) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::dfs_range if src doesn't exist in the graph");
+			}
+			return dfs_from(*it);
+		}
+		// The outgoing edges of src in the usual edge order, as iterator values.
+		[[nodiscard]] auto edges_from(const N& src) const -> generator<typename iterator::value_type> {
+			if (not nodes_.contains(src)) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::edges_from if src doesn't exist in the "
+				                         "graph");
+			}
+			return edges_of(edges_.find(src));
+		}
 		auto erase_node(const N& value) -> bool {
 			const auto node_sp = find_node(value);
 			if (not is_node(value)) {
@@ -388,6 +680,21 @@ namespace gdwg {
 			}
 			return true;
 		}
+		// Like erase_node, but sweeps the other sources' edge sets for edges to value in parallel.
+		auto erase_node(const parallel_policy& policy, const N& value) -> bool {
+			const auto node_it = nodes_.find(value);
+			if (node_it == nodes_.end()) {
+				return false;
+			}
+			const auto node_sp = *node_it;
+			edges_.erase(node_sp);
+			sweep(policy, [&](auto& dst_set) {
+				const auto [first, last] = dst_set.equal_range(value);
+				dst_set.erase(first, last);
+			});
+			nodes_.erase(node_it);
+			return true;
+		}
 		auto erase_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> bool {
 			const auto src_sp = find_node(src);
 			const auto dst_sp = find_node(dst);
@@ -515,27 +822,147 @@ namespace gdwg {
 			}
 			nodes_.erase(old_node_sp);
 		}
-		friend auto operator<<(std::ostream& os, const graph& g) -> std::ostream& {
-			if (g.nodes_.empty()) {
-				return os;
+		// Like merge_replace_node, but redirects the other sources' edges to old_data in parallel.
+		auto merge_replace_node(const parallel_policy& policy, const N& old_data, const N& new_data) -> void {
+			if (not is_node(old_data) or not is_node(new_data)) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::merge_replace_node on old or new data if they "
+				                         "don't exist in the graph");
+			}
+			if (old_data == new_data) {
+				return;
+			}
+			auto old_node_sp = find_node(old_data);
+			auto new_node_sp = find_node(new_data);
+			if (auto it = edges_.find(old_node_sp); it != edges_.end()) {
+				if (not it->second.empty()) {
+					edges_[new_node_sp].insert(it->second.begin(), it->second.end());
+				}
+				edges_.erase(it);
+			}
+			sweep(policy, [&](auto& dst_set) {
+				const auto [first, last] = dst_set.equal_range(old_data);
+				auto weights = std::vector<std::optional<E>>{};
+				for (auto it = first; it != last; ++it) {
+					weights.push_back(it->second);
+				}
+				dst_set.erase(first, last);
+				for (auto& weight : weights) {
+					dst_set.emplace(new_node_sp, std::move(weight));
+				}
+			});
+			nodes_.erase(old_node_sp);
+		}
+		// Applies the batch as if by the matching member calls in order, and returns what each call would have
+		// returned (merge_replace_node reports whether it changed anything). The whole batch is checked first, so an
+		// operation that would throw leaves the graph untouched. Runs of edge operations are applied grouped by
+		// source, and runs of erase_node share one sweep of the edge sets.
+		auto apply_batch(const batch& b) -> std::vector<bool> {
+			using op_kind = typename batch::op_kind;
+			const auto& ops = b.ops_;
+			validate_batch(ops);
+			const auto is_edge_op = [&](std::size_t i) {
+				return ops[i].kind == op_kind::insert_edge or ops[i].kind == op_kind::erase_edge;
+			};
+			auto results = std::vector<bool>(ops.size());
+			for (auto first = std::size_t{0}; first < ops.size();) {
+				auto last = first + 1;
+				const auto& op = ops[first];
+				if (is_edge_op(first)) {
+					while (last < ops.size() and is_edge_op(last)) {
+						++last;
+					}
+					apply_edge_ops(ops, first, last, results);
+				}
+				else if (op.kind == op_kind::erase_node) {
+					while (last < ops.size() and ops[last].kind == op_kind::erase_node) {
+						++last;
+					}
+					apply_node_erasures(ops, first, last, results);
+				}
+				else if (op.kind == op_kind::insert_node) {
+					results[first] = insert_node(op.first);
+				}
+				else if (op.kind == op_kind::replace_node) {
+					results[first] = replace_node(op.first, *op.second);
+				}
+				else {
+					merge_replace_node(op.first, *op.second);
+					results[first] = op.first != *op.second;
+				}
+				first = last;
 			}
+			return results;
+		}
+		friend auto operator<<(std::ostream& os, const graph& g) -> std::ostream& {
 			for (const auto& node : g.nodes_) {
-				os << *node << " (\n";
-				if (auto it = g.edges_.find(node); it != g.edges_.end()) {
-					for (const auto& edge_pair : it->second) {
-						if (edge_pair.second == std::nullopt) {
-							os << "  " << *node << " -> " << *(edge_pair.first) << " | U\n";
-						}
+				g.print_node(os, node);
+			}
+			return os;
+		}
+		// Writes the same text as operator<<, formatting each node's block on its own worker.
+		auto print(std::ostream& os, const parallel_policy& policy) const -> std::ostream& {
+			const auto nodes = std::vector<std::shared_ptr<N>>(nodes_.begin(), nodes_.end());
+			auto blocks = std::vector<std::string>(nodes.size());
+			detail::parallel_for(policy.pool, nodes.size(), policy.threads, [&](std::size_t, std::size_t i) {
+				auto block = std::ostringstream{};
+				print_node(block, nodes[i]);
+				blocks[i] = std::move(block).str();
+			});
+			for (const auto& block : blocks) {
+				os << block;
+			}
+			return os;
+		}
+		// Writes the graph in the binary format that graph_view::open_mmap serves without parsing.
+		auto save_binary(const std::string& path) const -> void
+		    requires detail::binary_value<N> and detail::binary_value<E>
+		{
+			detail::save_binary(*this, path);
+		}
+		template<typename Range>
+		[[nodiscard]] auto induced_subgraph(const Range& values) const -> graph {
+			auto keep = std::vector<std::shared_ptr<N>>{};
+			for (const auto& value : values) {
+				auto node = find_node(value);
+				if (node == nullptr) {
+					throw std::runtime_error("Cannot call gdwg::graph<N, E>::induced_subgraph on a node that doesn't "
+					                         "exist in the graph");
+				}
+				keep.push_back(std::move(node));
+			}
+			std::sort(keep.begin(), keep.end(), shared_ptr_less{});
+			keep.erase(std::unique(keep.begin(), keep.end()), keep.end());
+			return subgraph_of(keep);
+		}
+		[[nodiscard]] auto induced_subgraph(std::initializer_list<N> il) const -> graph {
+			return induced_subgraph<std::initializer_list<N>>(il);
+		}
+		// The subgraph induced by every node within k outgoing hops of seed, seed included.
+		[[nodiscard]] auto k_hop_subgraph(const N& seed, std::size_t k) const -> graph {
+			auto node = find_node(seed);
+			if (node == nullptr) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::k_hop_subgraph if seed doesn't exist in the "
+				                         "graph");
+			}
+			auto seen = std::unordered_set<const N*>{node.get()};
+			auto keep = std::vector<std::shared_ptr<N>>{std::move(node)};
+			for (auto first = std::size_t{0}, hop = std::size_t{0}; hop < k and first < keep.size(); ++hop) {
+				const auto last = keep.size();
+				for (auto i = first; i < last; ++i) {
+					const auto it = edges_.find(keep[i]);
+					if (it == edges_.end()) {
+						continue;
 					}
-					for (const auto& edge_pair : it->second) {
-						if (edge_pair.second != std::nullopt) {
-							os << "  " << *node << " -> " << *(edge_pair.first) << " | W | " << *edge_pair.second << "\n";
+					for (const auto& edge : it->second) {
+						if (seen.insert(edge.first.get()).second) {
+							keep.push_back(edge.first);
 						}
 					}
 				}
-				os << ")\n";
+				first = last;
 			}
-			return os;
+			std::sort(keep.begin(), keep.end(), shared_ptr_less{});
+			return subgraph_of(keep);
 		}
 		[[nodiscard]] auto begin() const -> iterator {
 			return iterator(edges_.cbegin(), edges_.cend());
@@ -586,16 +1013,5664 @@ namespace gdwg {
 			return true;
 		}
 
+		// Same result as operator==. Both trees are sorted by value, so entries are compared pairwise in parallel.
+		[[nodiscard]] auto equals(const parallel_policy& policy, const graph& other) const -> bool {
+			if (nodes_.size() != other.nodes_.size() or edges_.size() != other.edges_.size()) {
+				return false;
+			}
+			const auto nodes = std::vector<std::shared_ptr<N>>(nodes_.begin(), nodes_.end());
+			const auto other_nodes = std::vector<std::shared_ptr<N>>(other.nodes_.begin(), other.nodes_.end());
+			const auto sources = entries(edges_);
+			const auto other_sources = entries(other.edges_);
+			auto equal = std::atomic<bool>{true};
+			const auto count = nodes.size() + sources.size();
+			detail::parallel_for(policy.pool, count, policy.threads, [&](std::size_t, std::size_t i) {
+				if (not equal.load(std::memory_order_relaxed)) {
+					return;
+				}
+				if (i < nodes.size()) {
+					if (*nodes[i] != *other_nodes[i]) {
+						equal.store(false, std::memory_order_relaxed);
+					}
+					return;
+				}
+				const auto& [src, dst_set] = *sources[i - nodes.size()];
+				const auto& [other_src, other_dst_set] = *other_sources[i - nodes.size()];
+				const auto same_edge = [](const auto& lhs, const auto& rhs) {
+					return *lhs.first == *rhs.first and lhs.second == rhs.second;
+				};
+				if (*src != *other_src or not std::ranges::equal(dst_set, other_dst_set, same_edge)) {
+					equal.store(false, std::memory_order_relaxed);
+				}
+			});
+			return equal.load();
+		}
+
 	 private:
+		friend struct detail::graph_access;
 		std::set<std::shared_ptr<N>, shared_ptr_less> nodes_;
 		std::map<std::shared_ptr<N>, std::set<std::pair<std::shared_ptr<N>, std::optional<E>>, pair_less>, shared_ptr_less> edges_;
 		auto find_node(const N& value) const noexcept -> std::shared_ptr<N> {
-			for (const auto& node : nodes_) {
-				if (*node == value) {
-					return node;
+			const auto it = nodes_.find(value);
+			return it != nodes_.end() ? *it : nullptr;
+		}
+		// Pointers to every (source, edge set) entry, so parallel loops can index them.
+		static auto entries(const decltype(edges_)& edges)
+		    -> std::vector<const typename decltype(edges_)::value_type*> {
+			auto res = std::vector<const typename decltype(edges_)::value_type*>{};
+			res.reserve(edges.size());
+			for (const auto& entry : edges) {
+				res.push_back(&entry);
+			}
+			return res;
+		}
+		// Calls fn on every source's edge set, each on one worker.
+		template<typename F>
+		auto sweep(const parallel_policy& policy, F fn) -> void {
+			auto sets = std::vector<typename decltype(edges_)::mapped_type*>{};
+			sets.reserve(edges_.size());
+			for (auto& [src, dst_set] : edges_) {
+				sets.push_back(&dst_set);
+			}
+			detail::parallel_for(policy.pool, sets.size(), policy.threads, [&](std::size_t, std::size_t i) {
+				fn(*sets[i]);
+			});
+		}
+		// Replays the batch against the node set alone, throwing for the first operation whose member call would.
+		auto validate_batch(const std::vector<typename batch::operation>& ops) const -> void {
+			using op_kind = typename batch::op_kind;
+			auto changed = std::map<N, bool>{};
+			const auto present = [&](const N& value) {
+				const auto it = changed.find(value);
+				return it != changed.end() ? it->second : nodes_.contains(value);
+			};
+			for (const auto& op : ops) {
+				if (op.kind == op_kind::insert_node) {
+					changed.insert_or_assign(op.first, true);
+				}
+				else if (op.kind == op_kind::erase_node) {
+					changed.insert_or_assign(op.first, false);
+				}
+				else if (op.kind == op_kind::insert_edge or op.kind == op_kind::erase_edge) {
+					if (not present(op.first) or not present(*op.second)) {
+						throw std::runtime_error("Cannot call gdwg::graph<N, E>::apply_batch when either src or dst "
+						                         "node of an edge does not exist");
+					}
+				}
+				else if (op.kind == op_kind::replace_node) {
+					if (not present(op.first)) {
+						throw std::runtime_error("Cannot call gdwg::graph<N, E>::apply_batch to replace a node that "
+						                         "doesn't exist");
+					}
+					if (not present(*op.second)) {
+						changed.insert_or_assign(op.first, false);
+						changed.insert_or_assign(*op.second, true);
+					}
+				}
+				else {
+					if (not present(op.first) or not present(*op.second)) {
+						throw std::runtime_error("Cannot call gdwg::graph<N, E>::apply_batch to merge nodes that don't "
+						                         "exist");
+					}
+					if (op.first != *op.second) {
+						changed.insert_or_assign(op.first, false);
+					}
+				}
+			}
+		}
+		// Applies ops[first, last), which are all edge insertions and erasures. Operations on different edges
+		// commute, so they are sorted by (src, dst, weight), keeping the order of operations on the same edge.
+		// Each source's edge set is then looked up once and walked in order with hints.
+		auto apply_edge_ops(const std::vector<typename batch::operation>& ops,
+		                    std::size_t first,
+		                    std::size_t last,
+		                    std::vector<bool>& results) -> void {
+			auto order = std::vector<std::size_t>(last - first);
+			std::iota(order.begin(), order.end(), first);
+			std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+				return std::tie(ops[lhs].first, *ops[lhs].second, ops[lhs].weight)
+				       < std::tie(ops[rhs].first, *ops[rhs].second, ops[rhs].weight);
+			});
+			for (auto i = std::size_t{0}; i < order.size();) {
+				const auto& src = ops[order[i]].first;
+				auto src_it = edges_.find(src);
+				// erase_edge drops a source's entry when it removes the last edge, but leaves an entry that was
+				// already empty alone.
+				auto drop_if_empty = src_it == edges_.end();
+				if (drop_if_empty) {
+					src_it = edges_.emplace(*nodes_.find(src), typename decltype(edges_)::mapped_type{}).first;
+				}
+				auto& dst_set = src_it->second;
+				auto hint = dst_set.begin();
+				auto dst_sp = std::shared_ptr<N>{};
+				for (; i < order.size() and ops[order[i]].first == src; ++i) {
+					const auto& op = ops[order[i]];
+					if (dst_sp == nullptr or *dst_sp != *op.second) {
+						dst_sp = *nodes_.find(*op.second);
+					}
+					if (op.kind == batch::op_kind::insert_edge) {
+						const auto size = dst_set.size();
+						hint = std::next(dst_set.emplace_hint(hint, dst_sp, op.weight));
+						results[order[i]] = dst_set.size() != size;
+					}
+					else {
+						const auto it = dst_set.find({dst_sp, op.weight});
+						if (it != dst_set.end()) {
+							hint = dst_set.erase(it);
+							results[order[i]] = drop_if_empty = true;
+						}
+						else {
+							hint = dst_set.lower_bound({dst_sp, op.weight});
+						}
+					}
+				}
+				if (drop_if_empty and dst_set.empty()) {
+					edges_.erase(src_it);
+				}
+			}
+		}
+		// Applies ops[first, last), which are all node erasures, with one pass over the remaining edge sets.
+		auto apply_node_erasures(const std::vector<typename batch::operation>& ops,
+		                         std::size_t first,
+		                         std::size_t last,
+		                         std::vector<bool>& results) -> void {
+			auto erased = std::vector<std::shared_ptr<N>>{};
+			for (auto i = first; i < last; ++i) {
+				const auto it = nodes_.find(ops[i].first);
+				results[i] = it != nodes_.end();
+				if (it != nodes_.end()) {
+					erased.push_back(*it);
+					edges_.erase(*it);
+					nodes_.erase(it);
+				}
+			}
+			if (erased.empty()) {
+				return;
+			}
+			auto gone = std::unordered_set<const N*>{};
+			for (const auto& node : erased) {
+				gone.insert(node.get());
+			}
+			for (auto& [src, dst_set] : edges_) {
+				std::erase_if(dst_set, [&](const auto& edge) { return gone.contains(edge.first.get()); });
+			}
+		}
+		auto print_node(std::ostream& os, const std::shared_ptr<N>& node) const -> void {
+			os << *node << " (\n";
+			if (auto it = edges_.find(node); it != edges_.end()) {
+				for (const auto& edge_pair : it->second) {
+					if (edge_pair.second == std::nullopt) {
+						os << "  " << *node << " -> " << *(edge_pair.first) << " | U\n";
+					}
 				}
+				for (const auto& edge_pair : it->second) {
+					if (edge_pair.second != std::nullopt) {
+						os << "  " << *node << " -> " << *(edge_pair.first) << " | W | " << *edge_pair.second << "\n";
+					}
+				}
+			}
+			os << ")\n";
+		}
+// GCC 12 reports the compiler-generated coroutine frame cleanup as a zero-as-null-pointer use.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+		auto bfs_from(std::shared_ptr<N> src) const -> generator<const N&> {
+			auto seen = std::unordered_set<const N*>{src.get()};
+			auto queue = std::deque<const std::shared_ptr<N>*>{};
+			co_yield *src;
+			const auto* current = &src;
+			for (;;) {
+				if (const auto it = edges_.find(*current); it != edges_.end()) {
+					for (const auto& [dst, weight] : it->second) {
+						if (seen.insert(dst.get()).second) {
+							co_yield *dst;
+							queue.push_back(&dst);
+						}
+					}
+				}
+				if (queue.empty()) {
+					co_return;
+				}
+				current = queue.front();
+				queue.pop_front();
+			}
+		}
+		auto dfs_from(std::shared_ptr<N> src) const -> generator<const N&> {
+			using edge_iterator = typename decltype(edges_)::mapped_type::const_iterator;
+			auto seen = std::unordered_set<const N*>{src.get()};
+			auto stack = std::vector<std::pair<edge_iterator, edge_iterator>>{};
+			const auto push = [&](const std::shared_ptr<N>& node) {
+				if (const auto it = edges_.find(node); it != edges_.end()) {
+					stack.emplace_back(it->second.begin(), it->second.end());
+				}
+			};
+			co_yield *src;
+			push(src);
+			while (not stack.empty()) {
+				auto& [next, last] = stack.back();
+				if (next == last) {
+					stack.pop_back();
+					continue;
+				}
+				const auto& dst = (next++)->first;
+				if (seen.insert(dst.get()).second) {
+					co_yield *dst;
+					push(dst);
+				}
+			}
+		}
+		auto edges_of(typename decltype(edges_)::const_iterator it) const -> generator<typename iterator::value_type> {
+			if (it == edges_.end()) {
+				co_return;
+			}
+			for (const auto& [dst, weight] : it->second) {
+				// GCC 12 destroys braced temporaries in a co_yield operand twice, so yield a named value.
+				const auto value = typename iterator::value_type{*it->first, *dst, weight};
+				co_yield value;
+			}
+		}
+#pragma GCC diagnostic pop
+		// Builds a graph from copies of the given nodes, which must be sorted and unique, and of every edge
+		// between them. Both trees are filled in order with end hints, so each insertion is amortised O(1).
+		auto subgraph_of(const std::vector<std::shared_ptr<N>>& keep) const -> graph {
+			auto res = graph{};
+			auto copies = std::unordered_map<const N*, std::shared_ptr<N>>{};
+			copies.reserve(keep.size());
+			for (const auto& node : keep) {
+				auto copy = std::make_shared<N>(*node);
+				copies.emplace(node.get(), copy);
+				res.nodes_.emplace_hint(res.nodes_.end(), std::move(copy));
+			}
+			for (const auto& node : keep) {
+				const auto it = edges_.find(node);
+				if (it == edges_.end()) {
+					continue;
+				}
+				auto dst_set = typename decltype(edges_)::mapped_type{};
+				for (const auto& [dst, weight] : it->second) {
+					if (const auto copy = copies.find(dst.get()); copy != copies.end()) {
+						dst_set.emplace_hint(dst_set.end(), copy->second, weight);
+					}
+				}
+				if (not dst_set.empty()) {
+					res.edges_.emplace_hint(res.edges_.end(), copies.at(node.get()), std::move(dst_set));
+				}
+			}
+			return res;
+		}
+	};
+	namespace detail {
+		// Access to graph internals for the algorithms below, so they can walk the node and edge trees directly
+		// instead of going through the value-copying public accessors. Only bulk builders that keep the trees'
+		// invariants may use mutable_edges.
+		struct graph_access {
+			template<typename N, typename E>
+			static auto nodes(const graph<N, E>& g) noexcept -> const auto& {
+				return g.nodes_;
+			}
+			template<typename N, typename E>
+			static auto edges(const graph<N, E>& g) noexcept -> const auto& {
+				return g.edges_;
+			}
+			template<typename N, typename E>
+			static auto mutable_edges(graph<N, E>& g) noexcept -> auto& {
+				return g.edges_;
+			}
+		};
+		template<typename E>
+		auto edge_cost(const std::optional<E>& weight) -> double {
+			if constexpr (std::is_arithmetic_v<E>) {
+				return weight.has_value() ? static_cast<double>(*weight) : 1.0;
 			}
-			return nullptr;
+			else {
+				return 1.0;
+			}
+		}
+		// Compressed sparse row copy of a graph. Nodes are numbered in sorted order, arcs out of each node are
+		// sorted by target and parallel edges between the same pair are folded into one arc.
+		template<typename N>
+		struct csr {
+			std::vector<N> nodes;
+			std::vector<std::size_t> offsets;
+			std::vector<std::size_t> targets;
+			std::vector<double> costs;
+			[[nodiscard]] auto size() const noexcept -> std::size_t {
+				return nodes.size();
+			}
+			[[nodiscard]] auto index_of(const N& value) const -> std::optional<std::size_t> {
+				const auto it = std::lower_bound(nodes.begin(), nodes.end(), value);
+				if (it == nodes.end() or *it != value) {
+					return std::nullopt;
+				}
+				return static_cast<std::size_t>(it - nodes.begin());
+			}
+		};
+		// fold(acc, cost) combines the costs of parallel edges, e.g. min for path lengths or plus for capacities.
+		template<typename N, typename E, typename Fold>
+		auto make_csr(const graph<N, E>& g, Fold fold) -> csr<N> {
+			const auto& nodes = graph_access::nodes(g);
+			auto res = csr<N>{};
+			auto index = std::unordered_map<const N*, std::size_t>{};
+			index.reserve(nodes.size());
+			res.nodes.reserve(nodes.size());
+			for (const auto& node : nodes) {
+				index.emplace(node.get(), res.nodes.size());
+				res.nodes.push_back(*node);
+			}
+			res.offsets.assign(nodes.size() + 1, 0);
+			for (const auto& [src, dst_set] : graph_access::edges(g)) {
+				const auto first = res.targets.size();
+				for (const auto& [dst, weight] : dst_set) {
+					const auto v = index.at(dst.get());
+					const auto cost = edge_cost(weight);
+					if (res.targets.size() > first and res.targets.back() == v) {
+						res.costs.back() = fold(res.costs.back(), cost);
+					}
+					else {
+						res.targets.push_back(v);
+						res.costs.push_back(cost);
+					}
+				}
+				res.offsets[index.at(src.get()) + 1] = res.targets.size() - first;
+			}
+			std::partial_sum(res.offsets.begin(), res.offsets.end(), res.offsets.begin());
+			return res;
+		}
+		inline auto min_cost(double lhs, double rhs) -> double {
+			return std::min(lhs, rhs);
+		}
+		inline auto worker_count(std::size_t requested, std::size_t work) -> std::size_t {
+			const auto hardware = std::max(1U, std::thread::hardware_concurrency());
+			const auto count = requested != 0 ? requested : static_cast<std::size_t>(hardware);
+			return std::max(std::size_t{1}, std::min(count, work));
+		}
+		struct task {
+			std::function<void()> run;
+		};
+		// A Chase-Lev work-stealing deque of tasks. The owning worker pushes and takes at the bottom; any other
+		// thread may steal from the top. Indices only grow, so a full ring is replaced by one twice its size and
+		// the old rings are kept until the deque is destroyed, in case a thief is still reading one.
+		class work_deque {
+		 public:
+			work_deque() {
+				rings_.push_back(std::make_unique<ring>(64));
+				ring_.store(rings_.back().get());
+			}
+			// Owner only.
+			auto push(task* item) -> void {
+				const auto b = bottom_.load(std::memory_order_relaxed);
+				const auto t = top_.load(std::memory_order_acquire);
+				auto* current = ring_.load(std::memory_order_relaxed);
+				if (b - t >= static_cast<std::int64_t>(current->slots.size())) {
+					rings_.push_back(std::make_unique<ring>(2 * current->slots.size()));
+					for (auto i = t; i < b; ++i) {
+						auto* item = current->at(i).load(std::memory_order_relaxed);
+						rings_.back()->at(i).store(item, std::memory_order_relaxed);
+					}
+					current = rings_.back().get();
+					ring_.store(current, std::memory_order_release);
+				}
+				current->at(b).store(item, std::memory_order_relaxed);
+				bottom_.store(b + 1, std::memory_order_seq_cst);
+			}
+			// Owner only. Returns nullptr when empty or when a thief won the last task.
+			auto take() -> task* {
+				const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+				auto* current = ring_.load(std::memory_order_relaxed);
+				bottom_.store(b, std::memory_order_seq_cst);
+				auto t = top_.load(std::memory_order_seq_cst);
+				if (t > b) {
+					bottom_.store(b + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				auto* item = current->at(b).load(std::memory_order_relaxed);
+				if (t == b) {
+					if (not top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst)) {
+						item = nullptr;
+					}
+					bottom_.store(b + 1, std::memory_order_relaxed);
+				}
+				return item;
+			}
+			// Any thread. Returns nullptr when empty or when it lost a race.
+			auto steal() -> task* {
+				auto t = top_.load(std::memory_order_seq_cst);
+				const auto b = bottom_.load(std::memory_order_seq_cst);
+				if (t >= b) {
+					return nullptr;
+				}
+				auto* item = ring_.load(std::memory_order_acquire)->at(t).load(std::memory_order_relaxed);
+				return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst) ? item : nullptr;
+			}
+
+		 private:
+			struct ring {
+				explicit ring(std::size_t capacity)
+				: slots(capacity) {}
+				std::vector<std::atomic<task*>> slots;
+				auto at(std::int64_t i) -> std::atomic<task*>& {
+					return slots[static_cast<std::size_t>(i) & (slots.size() - 1)];
+				}
+			};
+			std::atomic<std::int64_t> top_ = 0;
+			std::atomic<std::int64_t> bottom_ = 0;
+			std::atomic<ring*> ring_ = nullptr;
+			std::vector<std::unique_ptr<ring>> rings_;
+		};
+		struct worker_identity {
+			thread_pool* pool = nullptr;
+			std::size_t index = 0;
+		};
+		inline thread_local auto current_worker = worker_identity{};
+		inline thread_local auto scoped_pool = static_cast<thread_pool*>(nullptr);
+	} // namespace detail
+	// A work-stealing thread pool shared by the library's parallel algorithms. Every worker owns a Chase-Lev
+	// deque: tasks forked on a worker go to its own deque, and idle workers steal from the others' tops. Tasks
+	// submitted from outside the pool go through a shared queue. Threads waiting for a task_group run queued
+	// tasks instead of blocking, so nested parallel loops cannot deadlock the pool.
+	class thread_pool {
+	 public:
+		// 0 threads means one fewer than the hardware threads, since the thread that starts a parallel loop
+		// works on it too. With pin set, worker i is pinned to CPU i modulo the hardware threads on Linux.
+		explicit thread_pool(std::size_t threads = 0, bool pin = false) {
+			const auto hardware = static_cast<std::size_t>(std::max(1U, std::thread::hardware_concurrency()));
+			const auto count = threads != 0 ? threads : hardware - 1;
+			for (auto i = std::size_t{0}; i < count; ++i) {
+				deques_.push_back(std::make_unique<detail::work_deque>());
+			}
+			workers_.reserve(count);
+			for (auto i = std::size_t{0}; i < count; ++i) {
+				workers_.emplace_back([this, i, pin, hardware] {
+#if defined(__linux__)
+					if (pin) {
+						auto cpus = cpu_set_t{};
+						CPU_ZERO(&cpus);
+						CPU_SET(i % hardware, &cpus);
+						pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+					}
+#else
+					static_cast<void>(pin);
+					static_cast<void>(hardware);
+#endif
+					work(i);
+				});
+			}
+		}
+		thread_pool(const thread_pool&) = delete;
+		auto operator=(const thread_pool&) -> thread_pool& = delete;
+		~thread_pool() {
+			{
+				const auto lock = std::lock_guard{mutex_};
+				stop_ = true;
+			}
+			wake_.notify_all();
+			for (auto& worker : workers_) {
+				worker.join();
+			}
+		}
+		[[nodiscard]] auto size() const noexcept -> std::size_t {
+			return workers_.size();
+		}
+
+	 private:
+		friend class task_group;
+		std::vector<std::unique_ptr<detail::work_deque>> deques_;
+		std::vector<std::thread> workers_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::deque<detail::task*> injected_;
+		std::atomic<std::size_t> queued_ = 0;
+		std::atomic<std::size_t> sleeping_ = 0;
+		bool stop_ = false;
+
+		auto submit(detail::task* item) -> void {
+			queued_.fetch_add(1);
+			if (detail::current_worker.pool == this) {
+				deques_[detail::current_worker.index]->push(item);
+			}
+			else {
+				const auto lock = std::lock_guard{mutex_};
+				injected_.push_back(item);
+			}
+			if (sleeping_.load() != 0) {
+				const auto lock = std::lock_guard{mutex_};
+				wake_.notify_one();
+			}
+		}
+		// The calling worker's own newest task, else the oldest task of another worker, else an injected one.
+		auto find_task() -> detail::task* {
+			if (queued_.load() == 0) {
+				return nullptr;
+			}
+			const auto self = detail::current_worker.pool == this ? detail::current_worker.index : deques_.size();
+			auto* item = self < deques_.size() ? deques_[self]->take() : nullptr;
+			for (auto k = std::size_t{1}; item == nullptr and k <= deques_.size(); ++k) {
+				const auto victim = (self + k) % deques_.size();
+				item = victim != self ? deques_[victim]->steal() : nullptr;
+			}
+			if (item == nullptr) {
+				const auto lock = std::lock_guard{mutex_};
+				if (not injected_.empty()) {
+					item = injected_.front();
+					injected_.pop_front();
+				}
+			}
+			if (item != nullptr) {
+				queued_.fetch_sub(1);
+			}
+			return item;
+		}
+		static auto execute(detail::task* item) -> void {
+			const auto owned = std::unique_ptr<detail::task>(item);
+			owned->run();
+		}
+		auto work(std::size_t index) -> void {
+			detail::current_worker = {this, index};
+			for (;;) {
+				if (auto* item = find_task()) {
+					execute(item);
+					continue;
+				}
+				auto lock = std::unique_lock{mutex_};
+				sleeping_.fetch_add(1);
+				wake_.wait(lock, [&] { return stop_ or queued_.load() != 0; });
+				sleeping_.fetch_sub(1);
+				if (stop_ and queued_.load() == 0) {
+					return;
+				}
+			}
+		}
+	};
+	namespace detail {
+		inline auto default_pool() -> thread_pool& {
+			static auto pool = thread_pool();
+			return pool;
+		}
+		// The pool installed by a pool_scope on this thread, else the pool this thread works for, else the
+		// library's default pool.
+		inline auto current_pool() -> thread_pool& {
+			if (scoped_pool != nullptr) {
+				return *scoped_pool;
+			}
+			return current_worker.pool != nullptr ? *current_worker.pool : default_pool();
+		}
+	} // namespace detail
+	// Makes the library's parallel algorithms called on this thread use the given pool, for example one shared
+	// with the rest of a service, until the scope ends.
+	class pool_scope {
+	 public:
+		explicit pool_scope(thread_pool& pool)
+		: previous_(std::exchange(detail::scoped_pool, &pool)) {}
+		pool_scope(const pool_scope&) = delete;
+		auto operator=(const pool_scope&) -> pool_scope& = delete;
+		~pool_scope() {
+			detail::scoped_pool = previous_;
+		}
+
+	 private:
+		thread_pool* previous_;
+	};
+	// Fork/join on a thread_pool: run() forks a task, wait() joins them all, running queued tasks meanwhile, and
+	// rethrows the first exception any of them threw.
+	class task_group {
+	 public:
+		explicit task_group(thread_pool& pool)
+		: pool_(pool) {}
+		task_group(const task_group&) = delete;
+		auto operator=(const task_group&) -> task_group& = delete;
+		~task_group() {
+			join();
+		}
+		template<typename F>
+		auto run(F fn) -> void {
+			pending_.fetch_add(1);
+			pool_.submit(new detail::task{[this, fn = std::move(fn)]() mutable {
+				try {
+					fn();
+				} catch (...) {
+					const auto lock = std::lock_guard{error_mutex_};
+					if (not error_) {
+						error_ = std::current_exception();
+					}
+				}
+				finish();
+			}});
+		}
+		auto wait() -> void {
+			join();
+			if (error_) {
+				std::rethrow_exception(std::exchange(error_, nullptr));
+			}
+		}
+
+	 private:
+		thread_pool& pool_;
+		std::atomic<std::size_t> pending_ = 0;
+		std::exception_ptr error_;
+		std::mutex error_mutex_;
+
+		// Last touch of this group by a task: once pending_ reaches zero the waiting thread may destroy it. The
+		// last task takes it to zero under the pool's lock and wakes the sleepers there, so a joiner asleep on
+		// the pool cannot miss it and the task touches only the pool afterwards.
+		auto finish() -> void {
+			auto& pool = pool_;
+			auto left = pending_.load(std::memory_order_relaxed);
+			while (left > 1) {
+				if (pending_.compare_exchange_weak(left, left - 1, std::memory_order_release)) {
+					return;
+				}
+			}
+			const auto lock = std::lock_guard{pool.mutex_};
+			pending_.fetch_sub(1, std::memory_order_release);
+			pool.wake_.notify_all();
+		}
+		// Runs queued tasks while there are any, since a pool may have no workers and a worker waiting here must
+		// not starve the tasks it waits for. Once none is left to run, sleeps on the pool until the group
+		// finishes or more work is queued.
+		auto join() -> void {
+			while (pending_.load(std::memory_order_acquire) != 0) {
+				if (auto* item = pool_.find_task()) {
+					thread_pool::execute(item);
+					continue;
+				}
+				auto lock = std::unique_lock{pool_.mutex_};
+				pool_.sleeping_.fetch_add(1);
+				pool_.wake_.wait(lock, [&] {
+					return pending_.load(std::memory_order_acquire) == 0 or pool_.queued_.load() != 0;
+				});
+				pool_.sleeping_.fetch_sub(1);
+			}
+		}
+	};
+	namespace detail {
+		// Calls fn(worker, i) for every i in [0, count) on at most `threads` workers, handing out items
+		// dynamically. Workers after the first are forked onto pool (the current pool if null). The first
+		// exception thrown by a worker is rethrown on the calling thread.
+		template<typename F>
+		auto parallel_for(thread_pool* pool, std::size_t count, std::size_t threads, F fn) -> void {
+			const auto workers = worker_count(threads, count);
+			if (workers == 1) {
+				for (auto i = std::size_t{0}; i < count; ++i) {
+					fn(std::size_t{0}, i);
+				}
+				return;
+			}
+			auto next = std::atomic<std::size_t>{0};
+			auto error = std::exception_ptr{};
+			auto error_mutex = std::mutex{};
+			auto body = [&](std::size_t worker) {
+				try {
+					for (auto i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+						fn(worker, i);
+					}
+				} catch (...) {
+					const auto lock = std::lock_guard{error_mutex};
+					if (not error) {
+						error = std::current_exception();
+					}
+					next.store(count);
+				}
+			};
+			auto group = task_group(pool != nullptr ? *pool : current_pool());
+			for (auto worker = std::size_t{1}; worker < workers; ++worker) {
+				group.run([&body, worker] { body(worker); });
+			}
+			body(0);
+			group.wait();
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+		template<typename F>
+		auto parallel_for(std::size_t count, std::size_t threads, F fn) -> void {
+			parallel_for(nullptr, count, threads, std::move(fn));
+		}
+		template<typename N>
+		auto to_node_map(const std::vector<N>& nodes, std::vector<double> values) -> std::map<N, double> {
+			auto res = std::map<N, double>{};
+			for (auto i = std::size_t{0}; i < nodes.size(); ++i) {
+				res.emplace_hint(res.end(), nodes[i], values[i]);
+			}
+			return res;
+		}
+		struct brandes_workspace {
+			explicit brandes_workspace(std::size_t n)
+			: dist(n, std::numeric_limits<double>::infinity())
+			, sigma(n, 0.0)
+			, delta(n, 0.0)
+			, centrality(n, 0.0) {}
+			std::vector<double> dist;
+			std::vector<double> sigma;
+			std::vector<double> delta;
+			std::vector<double> centrality;
+			std::vector<std::size_t> order;
+		};
+		// One Brandes round from source s: a BFS or Dijkstra pass that records nodes in non-decreasing distance
+		// order, then dependencies are accumulated back along shortest-path arcs into ws.centrality.
+		template<typename N>
+		auto brandes_source(const csr<N>& g, std::size_t s, bool weighted, brandes_workspace& ws) -> void {
+			auto cost = [&](std::size_t arc) { return weighted ? g.costs[arc] : 1.0; };
+			ws.dist[s] = 0.0;
+			ws.sigma[s] = 1.0;
+			if (weighted) {
+				using entry = std::pair<double, std::size_t>;
+				auto heap = std::priority_queue<entry, std::vector<entry>, std::greater<>>{};
+				heap.emplace(0.0, s);
+				while (not heap.empty()) {
+					const auto [d, v] = heap.top();
+					heap.pop();
+					if (d > ws.dist[v] or ws.delta[v] != 0.0) {
+						continue;
+					}
+					// delta doubles as the settled flag during the forward pass.
+					ws.delta[v] = 1.0;
+					ws.order.push_back(v);
+					for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+						const auto w = g.targets[arc];
+						const auto alt = d + cost(arc);
+						if (alt < ws.dist[w]) {
+							ws.dist[w] = alt;
+							ws.sigma[w] = ws.sigma[v];
+							heap.emplace(alt, w);
+						}
+						else if (alt == ws.dist[w]) {
+							ws.sigma[w] += ws.sigma[v];
+						}
+					}
+				}
+				for (const auto v : ws.order) {
+					ws.delta[v] = 0.0;
+				}
+			}
+			else {
+				ws.order.push_back(s);
+				for (auto head = std::size_t{0}; head < ws.order.size(); ++head) {
+					const auto v = ws.order[head];
+					for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+						const auto w = g.targets[arc];
+						if (ws.dist[w] == std::numeric_limits<double>::infinity()) {
+							ws.dist[w] = ws.dist[v] + 1.0;
+							ws.order.push_back(w);
+						}
+						if (ws.dist[w] == ws.dist[v] + 1.0) {
+							ws.sigma[w] += ws.sigma[v];
+						}
+					}
+				}
+			}
+			for (auto it = ws.order.rbegin(); it != ws.order.rend(); ++it) {
+				const auto v = *it;
+				for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+					const auto w = g.targets[arc];
+					if (ws.dist[w] == ws.dist[v] + cost(arc)) {
+						ws.delta[v] += ws.sigma[v] / ws.sigma[w] * (1.0 + ws.delta[w]);
+					}
+				}
+				if (v != s) {
+					ws.centrality[v] += ws.delta[v];
+				}
+			}
+			for (const auto v : ws.order) {
+				ws.dist[v] = std::numeric_limits<double>::infinity();
+				ws.sigma[v] = 0.0;
+				ws.delta[v] = 0.0;
+			}
+			ws.order.clear();
+		}
+	} // namespace detail
+
+	struct betweenness_options {
+		// Use edge weights as path lengths (unweighted edges count as 1) instead of hop counts.
+		bool weighted = false;
+		// Estimate from this many uniformly sampled sources and scale up, instead of running from every node.
+		std::optional<std::size_t> samples = std::nullopt;
+		std::uint64_t seed = 0;
+		// 0 means one worker per hardware thread.
+		std::size_t threads = 0;
+	};
+	template<typename N, typename E>
+	auto betweenness_centrality(const graph<N, E>& g, const betweenness_options& options = {})
+	    -> std::map<N, double> {
+		if (options.weighted and not std::is_arithmetic_v<E>) {
+			throw std::runtime_error("Cannot call gdwg::betweenness_centrality with weighted set if E is not "
+			                         "arithmetic");
+		}
+		const auto csr = detail::make_csr(g, detail::min_cost);
+		if (options.weighted
+		    and std::any_of(csr.costs.begin(), csr.costs.end(), [](double cost) { return cost < 0.0; }))
+		{
+			throw std::runtime_error("Cannot call gdwg::betweenness_centrality on a graph with negative edge "
+			                         "weights");
+		}
+		const auto n = csr.size();
+		auto sources = std::vector<std::size_t>(n);
+		std::iota(sources.begin(), sources.end(), std::size_t{0});
+		auto scale = 1.0;
+		if (options.samples.has_value() and *options.samples < n) {
+			auto rng = std::mt19937_64{options.seed};
+			for (auto i = std::size_t{0}; i < *options.samples; ++i) {
+				auto pick = std::uniform_int_distribution<std::size_t>{i, n - 1};
+				std::swap(sources[i], sources[pick(rng)]);
+			}
+			sources.resize(*options.samples);
+			scale = static_cast<double>(n) / static_cast<double>(std::max(std::size_t{1}, sources.size()));
+		}
+		const auto workers = detail::worker_count(options.threads, sources.size());
+		auto workspaces = std::vector<detail::brandes_workspace>(workers, detail::brandes_workspace{n});
+		detail::parallel_for(sources.size(), workers, [&](std::size_t worker, std::size_t i) {
+			detail::brandes_source(csr, sources[i], options.weighted, workspaces[worker]);
+		});
+		auto res = std::vector<double>(n, 0.0);
+		for (const auto& ws : workspaces) {
+			for (auto v = std::size_t{0}; v < n; ++v) {
+				res[v] += ws.centrality[v];
+			}
+		}
+		for (auto& value : res) {
+			value *= scale;
+		}
+		return detail::to_node_map(csr.nodes, std::move(res));
+	}
+	namespace detail {
+		// The undirected interpretation of g: u-v is an arc in both directions whenever u->v or v->u is, with the
+		// costs of both directions folded together. Self loops are dropped.
+		template<typename N, typename Fold>
+		auto undirected(const csr<N>& g, Fold fold) -> csr<N> {
+			const auto n = g.size();
+			auto offsets = std::vector<std::size_t>(n + 1, 0);
+			for (auto u = std::size_t{0}; u < n; ++u) {
+				for (auto arc = g.offsets[u]; arc < g.offsets[u + 1]; ++arc) {
+					if (g.targets[arc] != u) {
+						++offsets[u + 1];
+						++offsets[g.targets[arc] + 1];
+					}
+				}
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+			auto arcs = std::vector<std::pair<std::size_t, double>>(offsets[n]);
+			auto fill = std::vector<std::size_t>(offsets.begin(), offsets.end() - 1);
+			for (auto u = std::size_t{0}; u < n; ++u) {
+				for (auto arc = g.offsets[u]; arc < g.offsets[u + 1]; ++arc) {
+					const auto v = g.targets[arc];
+					if (v != u) {
+						arcs[fill[u]++] = {v, g.costs[arc]};
+						arcs[fill[v]++] = {u, g.costs[arc]};
+					}
+				}
+			}
+			auto res = csr<N>{};
+			res.nodes = g.nodes;
+			res.offsets.assign(n + 1, 0);
+			for (auto u = std::size_t{0}; u < n; ++u) {
+				const auto first = arcs.begin() + static_cast<std::ptrdiff_t>(offsets[u]);
+				const auto last = arcs.begin() + static_cast<std::ptrdiff_t>(offsets[u + 1]);
+				std::sort(first, last, [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+				for (auto it = first; it != last; ++it) {
+					if (it != first and res.targets.back() == it->first) {
+						res.costs.back() = fold(res.costs.back(), it->second);
+					}
+					else {
+						res.targets.push_back(it->first);
+						res.costs.push_back(it->second);
+					}
+				}
+				res.offsets[u + 1] = res.targets.size();
+			}
+			return res;
+		}
+		inline auto sum_cost(double lhs, double rhs) -> double {
+			return lhs + rhs;
+		}
+		template<typename N>
+		auto to_community_map(const std::vector<N>& nodes, const std::vector<std::size_t>& labels)
+		    -> std::map<N, std::size_t> {
+			auto renumbered = std::unordered_map<std::size_t, std::size_t>{};
+			auto res = std::map<N, std::size_t>{};
+			for (auto i = std::size_t{0}; i < nodes.size(); ++i) {
+				const auto id = renumbered.emplace(labels[i], renumbered.size()).first->second;
+				res.emplace_hint(res.end(), nodes[i], id);
+			}
+			return res;
+		}
+		// One level of the Louvain hierarchy: a symmetric weighted graph whose self loops are kept apart in
+		// `loops`, each holding the full weight of the edges collapsed into that node.
+		struct louvain_level {
+			std::vector<std::size_t> offsets;
+			std::vector<std::size_t> targets;
+			std::vector<double> weights;
+			std::vector<double> loops;
+			[[nodiscard]] auto size() const noexcept -> std::size_t {
+				return loops.size();
+			}
+			[[nodiscard]] auto degree(std::size_t u) const -> double {
+				auto res = 2.0 * loops[u];
+				for (auto arc = offsets[u]; arc < offsets[u + 1]; ++arc) {
+					res += weights[arc];
+				}
+				return res;
+			}
+		};
+		// Weight from u into community c, not counting u itself.
+		inline auto louvain_link(const louvain_level& level,
+		                         const std::vector<std::size_t>& community,
+		                         std::size_t u,
+		                         std::size_t c) -> double {
+			auto res = 0.0;
+			for (auto arc = level.offsets[u]; arc < level.offsets[u + 1]; ++arc) {
+				if (community[level.targets[arc]] == c) {
+					res += level.weights[arc];
+				}
+			}
+			return res;
+		}
+		// Local moving phase. Every sweep first picks each node's best community in parallel against a frozen
+		// view of the assignment, then commits the picks one by one, re-checking each against the live state so
+		// that every committed move strictly increases modularity. Returns whether any node moved.
+		inline auto louvain_move(const louvain_level& level,
+		                         std::vector<std::size_t>& community,
+		                         double total,
+		                         double resolution,
+		                         std::size_t threads) -> bool {
+			const auto n = level.size();
+			auto degree = std::vector<double>(n);
+			auto tot = std::vector<double>(n, 0.0);
+			for (auto u = std::size_t{0}; u < n; ++u) {
+				degree[u] = level.degree(u);
+				tot[community[u]] += degree[u];
+			}
+			auto gain = [&](std::size_t u, std::size_t c, double link) {
+				const auto others = community[u] == c ? tot[c] - degree[u] : tot[c];
+				return link - resolution * others * degree[u] / (2.0 * total);
+			};
+			auto moved_any = false;
+			auto candidate = std::vector<std::size_t>(n);
+			const auto workers = worker_count(threads, n);
+			auto links = std::vector<std::unordered_map<std::size_t, double>>(workers);
+			for (auto moved = true; moved;) {
+				moved = false;
+				parallel_for(n, workers, [&](std::size_t worker, std::size_t u) {
+					auto& link = links[worker];
+					link.clear();
+					link[community[u]] = 0.0;
+					for (auto arc = level.offsets[u]; arc < level.offsets[u + 1]; ++arc) {
+						link[community[level.targets[arc]]] += level.weights[arc];
+					}
+					auto best = community[u];
+					auto best_gain = gain(u, best, link[best]);
+					for (const auto& [c, weight] : link) {
+						const auto g = gain(u, c, weight);
+						if (g > best_gain or (g == best_gain and c < best and best != community[u])) {
+							best = c;
+							best_gain = g;
+						}
+					}
+					candidate[u] = best;
+				});
+				for (auto u = std::size_t{0}; u < n; ++u) {
+					const auto from = community[u];
+					const auto to = candidate[u];
+					if (to == from) {
+						continue;
+					}
+					if (gain(u, to, louvain_link(level, community, u, to))
+					    <= gain(u, from, louvain_link(level, community, u, from)) + 1e-12 * total)
+					{
+						continue;
+					}
+					tot[from] -= degree[u];
+					tot[to] += degree[u];
+					community[u] = to;
+					moved = true;
+					moved_any = true;
+				}
+			}
+			return moved_any;
+		}
+		// Collapses every community into a single node, renumbering communities densely in place.
+		inline auto louvain_aggregate(const louvain_level& level, std::vector<std::size_t>& community)
+		    -> louvain_level {
+			auto renumbered = std::vector<std::size_t>(level.size(), level.size());
+			auto count = std::size_t{0};
+			for (auto& c : community) {
+				if (renumbered[c] == level.size()) {
+					renumbered[c] = count++;
+				}
+				c = renumbered[c];
+			}
+			auto rows = std::vector<std::map<std::size_t, double>>(count);
+			auto res = louvain_level{};
+			res.loops.assign(count, 0.0);
+			for (auto u = std::size_t{0}; u < level.size(); ++u) {
+				res.loops[community[u]] += level.loops[u];
+				for (auto arc = level.offsets[u]; arc < level.offsets[u + 1]; ++arc) {
+					const auto v = level.targets[arc];
+					if (community[u] == community[v]) {
+						// Each internal edge is seen once from either end.
+						res.loops[community[u]] += level.weights[arc] / 2.0;
+					}
+					else {
+						rows[community[u]][community[v]] += level.weights[arc];
+					}
+				}
+			}
+			res.offsets.assign(count + 1, 0);
+			for (auto c = std::size_t{0}; c < count; ++c) {
+				for (const auto& [d, weight] : rows[c]) {
+					res.targets.push_back(d);
+					res.weights.push_back(weight);
+				}
+				res.offsets[c + 1] = res.targets.size();
+			}
+			return res;
+		}
+	} // namespace detail
+
+	struct label_propagation_options {
+		std::size_t max_iterations = 100;
+		std::uint64_t seed = 0;
+	};
+	// Asynchronous label propagation over the undirected interpretation of g: nodes are visited in a random order
+	// each sweep and adopt the label carrying the most edge weight among their neighbours, ties broken at random
+	// in favour of keeping the current label. Communities are numbered densely from 0 in node order.
+	template<typename N, typename E>
+	auto label_propagation(const graph<N, E>& g, const label_propagation_options& options = {})
+	    -> std::map<N, std::size_t> {
+		const auto csr = detail::undirected(detail::make_csr(g, detail::sum_cost), detail::sum_cost);
+		const auto n = csr.size();
+		auto labels = std::vector<std::size_t>(n);
+		std::iota(labels.begin(), labels.end(), std::size_t{0});
+		auto order = labels;
+		auto rng = std::mt19937_64{options.seed};
+		auto score = std::unordered_map<std::size_t, double>{};
+		auto best = std::vector<std::size_t>{};
+		for (auto iteration = std::size_t{0}; iteration < options.max_iterations; ++iteration) {
+			std::shuffle(order.begin(), order.end(), rng);
+			auto changed = false;
+			for (const auto u : order) {
+				if (csr.offsets[u] == csr.offsets[u + 1]) {
+					continue;
+				}
+				score.clear();
+				for (auto arc = csr.offsets[u]; arc < csr.offsets[u + 1]; ++arc) {
+					score[labels[csr.targets[arc]]] += csr.costs[arc];
+				}
+				auto top = -std::numeric_limits<double>::infinity();
+				best.clear();
+				for (const auto& [label, weight] : score) {
+					if (weight > top) {
+						top = weight;
+						best.assign(1, label);
+					}
+					else if (weight == top) {
+						best.push_back(label);
+					}
+				}
+				if (std::find(best.begin(), best.end(), labels[u]) != best.end()) {
+					continue;
+				}
+				std::sort(best.begin(), best.end());
+				labels[u] = best[std::uniform_int_distribution<std::size_t>{0, best.size() - 1}(rng)];
+				changed = true;
+			}
+			if (not changed) {
+				break;
+			}
+		}
+		return detail::to_community_map(csr.nodes, labels);
+	}
+
+	struct louvain_options {
+		// Values above 1 favour smaller communities, below 1 larger ones.
+		double resolution = 1.0;
+		std::size_t threads = 0;
+	};
+	template<typename N>
+	struct louvain_result {
+		std::map<N, std::size_t> communities;
+		double modularity = 0.0;
+	};
+	// Louvain modularity optimisation over the undirected interpretation of g, where the weight between two
+	// nodes is the sum of the edges between them in either direction. Self loops are ignored.
+	template<typename N, typename E>
+	auto louvain(const graph<N, E>& g, const louvain_options& options = {}) -> louvain_result<N> {
+		const auto csr = detail::undirected(detail::make_csr(g, detail::sum_cost), detail::sum_cost);
+		if (std::any_of(csr.costs.begin(), csr.costs.end(), [](double cost) { return cost < 0.0; })) {
+			throw std::runtime_error("Cannot call gdwg::louvain on a graph with negative edge weights");
+		}
+		const auto n = csr.size();
+		auto level = detail::louvain_level{csr.offsets, csr.targets, csr.costs, std::vector<double>(n, 0.0)};
+		const auto total = std::accumulate(csr.costs.begin(), csr.costs.end(), 0.0) / 2.0;
+		auto membership = std::vector<std::size_t>(n);
+		std::iota(membership.begin(), membership.end(), std::size_t{0});
+		while (total > 0.0) {
+			auto community = std::vector<std::size_t>(level.size());
+			std::iota(community.begin(), community.end(), std::size_t{0});
+			if (not detail::louvain_move(level, community, total, options.resolution, options.threads)) {
+				break;
+			}
+			level = detail::louvain_aggregate(level, community);
+			for (auto& c : membership) {
+				c = community[c];
+			}
+		}
+		auto res = louvain_result<N>{detail::to_community_map(csr.nodes, membership), 0.0};
+		if (total > 0.0) {
+			auto internal = std::vector<double>(n, 0.0);
+			auto tot = std::vector<double>(n, 0.0);
+			for (auto u = std::size_t{0}; u < n; ++u) {
+				for (auto arc = csr.offsets[u]; arc < csr.offsets[u + 1]; ++arc) {
+					tot[membership[u]] += csr.costs[arc];
+					if (membership[u] == membership[csr.targets[arc]]) {
+						internal[membership[u]] += csr.costs[arc] / 2.0;
+					}
+				}
+			}
+			for (auto c = std::size_t{0}; c < n; ++c) {
+				res.modularity += internal[c] / total
+				                  - options.resolution * (tot[c] / (2.0 * total)) * (tot[c] / (2.0 * total));
+			}
+		}
+		return res;
+	}
+	// The quotient graph of a community assignment: one node per community and one weighted edge per ordered
+	// pair of communities, carrying the summed weight of the edges between them (unweighted edges count as 1).
+	// Edges inside a community become a self loop.
+	template<typename N, typename E>
+	auto community_graph(const graph<N, E>& g, const std::map<N, std::size_t>& communities)
+	    -> graph<std::size_t, E> {
+		static_assert(std::is_arithmetic_v<E>, "community_graph sums edge weights, so E must be arithmetic");
+		auto community = std::unordered_map<const N*, std::size_t>{};
+		auto res = graph<std::size_t, E>{};
+		for (const auto& node : detail::graph_access::nodes(g)) {
+			const auto it = communities.find(*node);
+			if (it == communities.end()) {
+				throw std::runtime_error("Cannot call gdwg::community_graph without a community for every node");
+			}
+			community.emplace(node.get(), it->second);
+			res.insert_node(it->second);
+		}
+		auto weights = std::map<std::pair<std::size_t, std::size_t>, E>{};
+		for (const auto& [src, dst_set] : detail::graph_access::edges(g)) {
+			for (const auto& [dst, weight] : dst_set) {
+				weights[{community.at(src.get()), community.at(dst.get())}] += weight.value_or(E{1});
+			}
+		}
+		for (const auto& [pair, weight] : weights) {
+			res.insert_edge(pair.first, pair.second, weight);
+		}
+		return res;
+	}
+	namespace detail {
+		// Iterative Tarjan. Components are numbered in topological order, so every arc u->v satisfies
+		// component[u] <= component[v]. Returns the component of each node and the number of components.
+		template<typename N>
+		auto strongly_connected_components(const csr<N>& g) -> std::pair<std::vector<std::size_t>, std::size_t> {
+			const auto n = g.size();
+			const auto unvisited = std::numeric_limits<std::size_t>::max();
+			auto index = std::vector<std::size_t>(n, unvisited);
+			auto low = std::vector<std::size_t>(n, 0);
+			auto on_stack = std::vector<bool>(n, false);
+			auto component = std::vector<std::size_t>(n, unvisited);
+			auto stack = std::vector<std::size_t>{};
+			auto frames = std::vector<std::pair<std::size_t, std::size_t>>{};
+			auto counter = std::size_t{0};
+			auto count = std::size_t{0};
+			auto visit = [&](std::size_t v) {
+				index[v] = low[v] = counter++;
+				stack.push_back(v);
+				on_stack[v] = true;
+				frames.emplace_back(v, g.offsets[v]);
+			};
+			for (auto s = std::size_t{0}; s < n; ++s) {
+				if (index[s] != unvisited) {
+					continue;
+				}
+				visit(s);
+				while (not frames.empty()) {
+					const auto v = frames.back().first;
+					const auto arc = frames.back().second;
+					if (arc < g.offsets[v + 1]) {
+						++frames.back().second;
+						const auto w = g.targets[arc];
+						if (index[w] == unvisited) {
+							visit(w);
+						}
+						else if (on_stack[w]) {
+							low[v] = std::min(low[v], index[w]);
+						}
+						continue;
+					}
+					frames.pop_back();
+					if (not frames.empty()) {
+						low[frames.back().first] = std::min(low[frames.back().first], low[v]);
+					}
+					if (low[v] == index[v]) {
+						auto w = v;
+						do {
+							w = stack.back();
+							stack.pop_back();
+							on_stack[w] = false;
+							component[w] = count;
+						} while (w != v);
+						++count;
+					}
+				}
+			}
+			// Tarjan completes sink components first.
+			for (auto& c : component) {
+				c = count - 1 - c;
+			}
+			return {std::move(component), count};
+		}
+	} // namespace detail
+
+	// A precomputed answer to "is there a path from src to dst". Nodes are collapsed into their strongly
+	// connected components, and the resulting DAG is labelled with a topological order, the pre/post intervals
+	// of a spanning forest (contained interval: reachable) and a few randomised GRAIL intervals (not contained:
+	// unreachable). Pairs that no label settles fall back to a bidirectional search of the DAG pruned by the same
+	// labels. The index is a snapshot: it does not follow later changes to the graph.
+	template<typename N>
+	class reachability_index {
+	 public:
+		template<typename E>
+		explicit reachability_index(const graph<N, E>& g, std::size_t labels = 2, std::uint64_t seed = 0) {
+			const auto csr = detail::make_csr(g, detail::min_cost);
+			auto [component, count] = detail::strongly_connected_components(csr);
+			nodes_ = csr.nodes;
+			component_ = std::move(component);
+			auto forward = std::vector<std::vector<std::size_t>>(count);
+			auto backward = std::vector<std::vector<std::size_t>>(count);
+			for (auto u = std::size_t{0}; u < csr.size(); ++u) {
+				for (auto arc = csr.offsets[u]; arc < csr.offsets[u + 1]; ++arc) {
+					const auto cu = component_[u];
+					const auto cv = component_[csr.targets[arc]];
+					if (cu != cv) {
+						forward[cu].push_back(cv);
+						backward[cv].push_back(cu);
+					}
+				}
+			}
+			flatten(forward, forward_offsets_, forward_targets_);
+			flatten(backward, backward_offsets_, backward_targets_);
+			label_tree(count);
+			auto rng = std::mt19937_64{seed};
+			for (auto i = std::size_t{0}; i < labels; ++i) {
+				label_grail(count, rng);
+			}
+		}
+		[[nodiscard]] auto reaches(const N& src, const N& dst) const -> bool {
+			const auto src_it = std::lower_bound(nodes_.begin(), nodes_.end(), src);
+			const auto dst_it = std::lower_bound(nodes_.begin(), nodes_.end(), dst);
+			if (src_it == nodes_.end() or *src_it != src or dst_it == nodes_.end() or *dst_it != dst) {
+				throw std::runtime_error("Cannot call gdwg::reachability_index<N>::reaches if src or dst node don't "
+				                         "exist in the graph");
+			}
+			return reaches_component(component_[static_cast<std::size_t>(src_it - nodes_.begin())],
+			                         component_[static_cast<std::size_t>(dst_it - nodes_.begin())]);
+		}
+
+	 private:
+		std::vector<N> nodes_;
+		std::vector<std::size_t> component_;
+		std::vector<std::size_t> forward_offsets_;
+		std::vector<std::size_t> forward_targets_;
+		std::vector<std::size_t> backward_offsets_;
+		std::vector<std::size_t> backward_targets_;
+		std::vector<std::size_t> pre_;
+		std::vector<std::size_t> post_;
+		// grail_[i] holds the (lowest descendant rank, own rank) interval of every component in labelling i.
+		std::vector<std::vector<std::pair<std::size_t, std::size_t>>> grail_;
+
+		static auto flatten(std::vector<std::vector<std::size_t>>& rows,
+		                    std::vector<std::size_t>& offsets,
+		                    std::vector<std::size_t>& targets) -> void {
+			offsets.assign(1, 0);
+			for (auto& row : rows) {
+				std::sort(row.begin(), row.end());
+				row.erase(std::unique(row.begin(), row.end()), row.end());
+				targets.insert(targets.end(), row.begin(), row.end());
+				offsets.push_back(targets.size());
+			}
+		}
+		auto label_tree(std::size_t count) -> void {
+			const auto unvisited = std::numeric_limits<std::size_t>::max();
+			pre_.assign(count, unvisited);
+			post_.assign(count, 0);
+			auto clock = std::size_t{0};
+			auto frames = std::vector<std::pair<std::size_t, std::size_t>>{};
+			for (auto root = std::size_t{0}; root < count; ++root) {
+				if (pre_[root] != unvisited) {
+					continue;
+				}
+				pre_[root] = clock++;
+				frames.emplace_back(root, forward_offsets_[root]);
+				while (not frames.empty()) {
+					const auto [c, arc] = frames.back();
+					if (arc == forward_offsets_[c + 1]) {
+						post_[c] = clock++;
+						frames.pop_back();
+						continue;
+					}
+					++frames.back().second;
+					const auto d = forward_targets_[arc];
+					if (pre_[d] == unvisited) {
+						pre_[d] = clock++;
+						frames.emplace_back(d, forward_offsets_[d]);
+					}
+				}
+			}
+		}
+		auto label_grail(std::size_t count, std::mt19937_64& rng) -> void {
+			auto roots = std::vector<std::size_t>(count);
+			std::iota(roots.begin(), roots.end(), std::size_t{0});
+			std::shuffle(roots.begin(), roots.end(), rng);
+			// Each component walks its children starting from a random rotation.
+			auto start = std::vector<std::size_t>(count);
+			for (auto c = std::size_t{0}; c < count; ++c) {
+				const auto degree = forward_offsets_[c + 1] - forward_offsets_[c];
+				start[c] = degree == 0 ? 0 : std::uniform_int_distribution<std::size_t>{0, degree - 1}(rng);
+			}
+			auto label = std::vector<std::pair<std::size_t, std::size_t>>(count, {0, 0});
+			auto visited = std::vector<bool>(count, false);
+			auto rank = std::size_t{0};
+			auto frames = std::vector<std::pair<std::size_t, std::size_t>>{};
+			for (const auto root : roots) {
+				if (visited[root]) {
+					continue;
+				}
+				visited[root] = true;
+				frames.emplace_back(root, 0);
+				label[root].first = std::numeric_limits<std::size_t>::max();
+				while (not frames.empty()) {
+					const auto [c, step] = frames.back();
+					const auto degree = forward_offsets_[c + 1] - forward_offsets_[c];
+					if (step == degree) {
+						label[c].second = rank++;
+						label[c].first = std::min(label[c].first, label[c].second);
+						frames.pop_back();
+						if (not frames.empty()) {
+							auto& parent = label[frames.back().first];
+							parent.first = std::min(parent.first, label[c].first);
+						}
+						continue;
+					}
+					++frames.back().second;
+					const auto d = forward_targets_[forward_offsets_[c] + (start[c] + step) % degree];
+					if (visited[d]) {
+						label[c].first = std::min(label[c].first, label[d].first);
+					}
+					else {
+						visited[d] = true;
+						label[d].first = std::numeric_limits<std::size_t>::max();
+						frames.emplace_back(d, 0);
+					}
+				}
+			}
+			grail_.push_back(std::move(label));
+		}
+		[[nodiscard]] auto tree_contains(std::size_t cu, std::size_t cv) const noexcept -> bool {
+			return pre_[cu] <= pre_[cv] and post_[cv] <= post_[cu];
+		}
+		// False only when cv is certainly unreachable from cu.
+		[[nodiscard]] auto may_reach(std::size_t cu, std::size_t cv) const noexcept -> bool {
+			if (cu > cv) {
+				return false;
+			}
+			return std::all_of(grail_.begin(), grail_.end(), [&](const auto& label) {
+				return label[cu].first <= label[cv].first and label[cv].second <= label[cu].second;
+			});
+		}
+		[[nodiscard]] auto reaches_component(std::size_t cu, std::size_t cv) const -> bool {
+			if (cu == cv or tree_contains(cu, cv)) {
+				return true;
+			}
+			if (not may_reach(cu, cv)) {
+				return false;
+			}
+			// Searches forwards from cu and backwards from cv, always growing the smaller frontier, and only
+			// through components the labels cannot rule out.
+			auto seen_forward = std::unordered_set<std::size_t>{cu};
+			auto seen_backward = std::unordered_set<std::size_t>{cv};
+			auto frontier_forward = std::vector<std::size_t>{cu};
+			auto frontier_backward = std::vector<std::size_t>{cv};
+			auto next = std::vector<std::size_t>{};
+			while (not frontier_forward.empty() and not frontier_backward.empty()) {
+				const auto forward = frontier_forward.size() <= frontier_backward.size();
+				const auto& offsets = forward ? forward_offsets_ : backward_offsets_;
+				const auto& targets = forward ? forward_targets_ : backward_targets_;
+				auto& frontier = forward ? frontier_forward : frontier_backward;
+				auto& seen = forward ? seen_forward : seen_backward;
+				const auto& other = forward ? seen_backward : seen_forward;
+				next.clear();
+				for (const auto c : frontier) {
+					for (auto arc = offsets[c]; arc < offsets[c + 1]; ++arc) {
+						const auto d = targets[arc];
+						if (other.count(d) != 0) {
+							return true;
+						}
+						if (forward ? tree_contains(d, cv) : tree_contains(cu, d)) {
+							return true;
+						}
+						if ((forward ? may_reach(d, cv) : may_reach(cu, d)) and seen.insert(d).second) {
+							next.push_back(d);
+						}
+					}
+				}
+				frontier.swap(next);
+			}
+			return false;
+		}
+	};
+	namespace detail {
+		// Per-thread Dijkstra state that is reused across searches. Bumping the epoch invalidates every
+		// distance and ban in O(1), so a search only pays for the nodes it actually touches.
+		struct shortest_path_workspace {
+			explicit shortest_path_workspace(std::size_t n)
+			: dist(n, 0.0)
+			, parent(n, 0)
+			, stamp(n, 0)
+			, banned(n, 0) {}
+			std::vector<double> dist;
+			std::vector<std::size_t> parent;
+			std::vector<std::uint64_t> stamp;
+			std::vector<std::uint64_t> banned;
+			std::uint64_t epoch = 0;
+			auto reset() noexcept -> void {
+				++epoch;
+			}
+			auto ban(std::size_t v) noexcept -> void {
+				banned[v] = epoch;
+			}
+			[[nodiscard]] auto reached(std::size_t v) const noexcept -> bool {
+				return stamp[v] == epoch;
+			}
+		};
+		// Shortest s-t path avoiding the nodes banned since the last reset and, when leaving s, the arcs to
+		// any node in skip. Returns the cost and the node sequence.
+		template<typename N>
+		auto dijkstra_path(const csr<N>& g,
+		                   shortest_path_workspace& ws,
+		                   std::size_t s,
+		                   std::size_t t,
+		                   const std::vector<std::size_t>& skip,
+		                   bool weighted) -> std::optional<std::pair<double, std::vector<std::size_t>>> {
+			using entry = std::pair<double, std::size_t>;
+			auto heap = std::priority_queue<entry, std::vector<entry>, std::greater<>>{};
+			ws.stamp[s] = ws.epoch;
+			ws.dist[s] = 0.0;
+			ws.parent[s] = s;
+			heap.emplace(0.0, s);
+			while (not heap.empty()) {
+				const auto [d, v] = heap.top();
+				heap.pop();
+				if (d > ws.dist[v]) {
+					continue;
+				}
+				if (v == t) {
+					auto path = std::vector<std::size_t>{t};
+					for (auto u = t; u != s; u = ws.parent[u]) {
+						path.push_back(ws.parent[u]);
+					}
+					std::reverse(path.begin(), path.end());
+					return std::pair{d, std::move(path)};
+				}
+				for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+					const auto w = g.targets[arc];
+					if (ws.banned[w] == ws.epoch
+					    or (v == s and std::find(skip.begin(), skip.end(), w) != skip.end()))
+					{
+						continue;
+					}
+					const auto alt = d + (weighted ? g.costs[arc] : 1.0);
+					if (not ws.reached(w) or alt < ws.dist[w]) {
+						ws.stamp[w] = ws.epoch;
+						ws.dist[w] = alt;
+						ws.parent[w] = v;
+						heap.emplace(alt, w);
+					}
+				}
+			}
+			return std::nullopt;
+		}
+		template<typename N>
+		auto arc_cost(const csr<N>& g, std::size_t u, std::size_t v, bool weighted) -> double {
+			if (not weighted) {
+				return 1.0;
+			}
+			const auto first = g.targets.begin() + static_cast<std::ptrdiff_t>(g.offsets[u]);
+			const auto last = g.targets.begin() + static_cast<std::ptrdiff_t>(g.offsets[u + 1]);
+			return g.costs[static_cast<std::size_t>(std::lower_bound(first, last, v) - g.targets.begin())];
+		}
+	} // namespace detail
+
+	template<typename N>
+	struct path {
+		std::vector<N> nodes;
+		double cost = 0.0;
+	};
+	struct k_shortest_paths_options {
+		// Use edge weights as path lengths (unweighted edges count as 1) instead of hop counts.
+		bool weighted = false;
+		std::size_t threads = 0;
+	};
+	// Yen's algorithm for the k cheapest loopless src-dst paths, cheapest first. All spur searches of a round run
+	// in parallel on the same CSR copy of the graph: root path nodes are banned in a per-thread workspace rather
+	// than removed from a copy of the graph.
+	template<typename N, typename E>
+	auto k_shortest_paths(const graph<N, E>& g,
+	                      const N& src,
+	                      const N& dst,
+	                      std::size_t k,
+	                      const k_shortest_paths_options& options = {}) -> std::vector<path<N>> {
+		if (options.weighted and not std::is_arithmetic_v<E>) {
+			throw std::runtime_error("Cannot call gdwg::k_shortest_paths with weighted set if E is not arithmetic");
+		}
+		const auto csr = detail::make_csr(g, detail::min_cost);
+		const auto s = csr.index_of(src);
+		const auto t = csr.index_of(dst);
+		if (not s or not t) {
+			throw std::runtime_error("Cannot call gdwg::k_shortest_paths if src or dst node don't exist in the "
+			                         "graph");
+		}
+		if (options.weighted
+		    and std::any_of(csr.costs.begin(), csr.costs.end(), [](double cost) { return cost < 0.0; }))
+		{
+			throw std::runtime_error("Cannot call gdwg::k_shortest_paths on a graph with negative edge weights");
+		}
+		using candidate = std::pair<double, std::vector<std::size_t>>;
+		const auto workers = detail::worker_count(options.threads, csr.size());
+		auto workspaces =
+		    std::vector<detail::shortest_path_workspace>(workers, detail::shortest_path_workspace{csr.size()});
+		auto accepted = std::vector<candidate>{};
+		auto candidates = std::set<candidate>{};
+		if (k > 0) {
+			workspaces[0].reset();
+			if (auto first = detail::dijkstra_path(csr, workspaces[0], *s, *t, {}, options.weighted)) {
+				accepted.push_back(std::move(*first));
+			}
+		}
+		while (not accepted.empty() and accepted.size() < k) {
+			const auto& previous = accepted.back().second;
+			auto root_cost = std::vector<double>(previous.size(), 0.0);
+			for (auto i = std::size_t{1}; i < previous.size(); ++i) {
+				root_cost[i] = root_cost[i - 1] + detail::arc_cost(csr, previous[i - 1], previous[i], options.weighted);
+			}
+			auto spurs = std::vector<std::optional<candidate>>(previous.size() - 1);
+			detail::parallel_for(spurs.size(), workers, [&](std::size_t worker, std::size_t i) {
+				auto& ws = workspaces[worker];
+				ws.reset();
+				for (auto j = std::size_t{0}; j < i; ++j) {
+					ws.ban(previous[j]);
+				}
+				const auto root_end = previous.begin() + static_cast<std::ptrdiff_t>(i);
+				auto skip = std::vector<std::size_t>{};
+				for (const auto& [cost, nodes] : accepted) {
+					if (nodes.size() > i + 1 and std::equal(previous.begin(), root_end + 1, nodes.begin())) {
+						skip.push_back(nodes[i + 1]);
+					}
+				}
+				if (auto spur = detail::dijkstra_path(csr, ws, previous[i], *t, skip, options.weighted)) {
+					auto nodes = std::vector<std::size_t>(previous.begin(), root_end);
+					nodes.insert(nodes.end(), spur->second.begin(), spur->second.end());
+					spurs[i] = candidate{root_cost[i] + spur->first, std::move(nodes)};
+				}
+			});
+			for (auto& spur : spurs) {
+				if (spur) {
+					candidates.insert(std::move(*spur));
+				}
+			}
+			if (candidates.empty()) {
+				break;
+			}
+			accepted.push_back(std::move(candidates.extract(candidates.begin()).value()));
+		}
+		auto res = std::vector<path<N>>{};
+		for (const auto& [cost, nodes] : accepted) {
+			auto& p = res.emplace_back();
+			p.cost = cost;
+			for (const auto v : nodes) {
+				p.nodes.push_back(csr.nodes[v]);
+			}
+		}
+		return res;
+	}
+	namespace detail {
+		// SplitMix64: a tiny, fast generator for per-walk streams that need no more than statistical quality.
+		struct splitmix64 {
+			std::uint64_t state;
+			auto next() noexcept -> std::uint64_t {
+				auto z = (state += 0x9e3779b97f4a7c15ULL);
+				z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+				z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+				return z ^ (z >> 31U);
+			}
+			// Uniform in [0, 1).
+			auto uniform() noexcept -> double {
+				return static_cast<double>(next() >> 11U) * 0x1.0p-53;
+			}
+			// Uniform in [0, n) for n > 0.
+			auto below(std::size_t n) noexcept -> std::size_t {
+				return std::min(n - 1, static_cast<std::size_t>(uniform() * static_cast<double>(n)));
+			}
+		};
+	} // namespace detail
+
+	struct random_walk_options {
+		// Number of nodes in each walk, including the start. Walks that reach a node with no way out stop early.
+		std::size_t length = 80;
+		// node2vec return parameter: the weight of stepping straight back to the previous node is 1 / p.
+		double p = 1.0;
+		// node2vec in-out parameter: the weight of stepping to a node not adjacent to the previous one is 1 / q.
+		double q = 1.0;
+		std::uint64_t seed = 0;
+		std::size_t threads = 0;
+	};
+	// Generates random walks, optionally with node2vec second-order biasing. Each node's next step is drawn in
+	// O(1) from an alias table built once from its outgoing edge weights (or uniformly when unweighted). The
+	// p/q bias is applied by rejection sampling against those tables, so no per-(previous, current) table is ever
+	// built. Walk i only depends on the seed and i, so the output does not depend on the thread count.
+	template<typename N>
+	class random_walker {
+	 public:
+		// Parallel edges are merged, their weights summed.
+		template<typename E>
+		explicit random_walker(const graph<N, E>& g, bool weighted = false, std::size_t threads = 0)
+		: csr_{detail::make_csr(g, detail::sum_cost)}
+		, weighted_{weighted} {
+			if (weighted and not std::is_arithmetic_v<E>) {
+				throw std::runtime_error("Cannot construct gdwg::random_walker with weighted set if E is not "
+				                         "arithmetic");
+			}
+			if (weighted) {
+				build_alias_tables(threads);
+			}
+		}
+		[[nodiscard]] auto walks(const std::vector<N>& starts, const random_walk_options& options = {}) const
+		    -> std::vector<std::vector<N>> {
+			auto indices = std::vector<std::size_t>{};
+			indices.reserve(starts.size());
+			for (const auto& start : starts) {
+				const auto index = csr_.index_of(start);
+				if (not index) {
+					throw std::runtime_error("Cannot call gdwg::random_walker<N>::walks from a node that doesn't exist "
+					                         "in the graph");
+				}
+				indices.push_back(*index);
+			}
+			if (not(options.p > 0.0) or not(options.q > 0.0)) {
+				throw std::runtime_error("Cannot call gdwg::random_walker<N>::walks unless p and q are positive");
+			}
+			auto res = std::vector<std::vector<N>>(indices.size());
+			detail::parallel_for(indices.size(), options.threads, [&](std::size_t, std::size_t i) {
+				auto rng = detail::splitmix64{options.seed ^ (0x5851f42d4c957f2dULL * (i + 1))};
+				auto& walk = res[i];
+				walk.reserve(options.length);
+				auto previous = indices[i];
+				auto current = indices[i];
+				for (auto step = std::size_t{0}; step < options.length; ++step) {
+					walk.push_back(csr_.nodes[current]);
+					if (step + 1 == options.length) {
+						break;
+					}
+					const auto next = step == 0 ? sample(current, rng) : sample(previous, current, options, rng);
+					if (not next) {
+						break;
+					}
+					previous = current;
+					current = *next;
+				}
+			});
+			return res;
+		}
+
+	 private:
+		detail::csr<N> csr_;
+		bool weighted_;
+		// Alias tables laid out like csr_.targets: arc a keeps its own target with probability accept_[a] and
+		// otherwise jumps to arc alias_[a] of the same node.
+		std::vector<double> accept_;
+		std::vector<std::size_t> alias_;
+		// Nodes whose outgoing weights sum to zero: walks stop there.
+		std::vector<bool> stuck_;
+
+		auto build_alias_tables(std::size_t threads) -> void {
+			if (std::any_of(csr_.costs.begin(), csr_.costs.end(), [](double cost) { return cost < 0.0; })) {
+				throw std::runtime_error("Cannot construct gdwg::random_walker on a graph with negative edge weights");
+			}
+			accept_.assign(csr_.targets.size(), 1.0);
+			alias_.resize(csr_.targets.size());
+			std::iota(alias_.begin(), alias_.end(), std::size_t{0});
+			stuck_.assign(csr_.size(), false);
+			auto stuck = std::vector<char>(csr_.size(), 0);
+			detail::parallel_for(csr_.size(), threads, [&](std::size_t, std::size_t u) {
+				// Vose's method.
+				const auto first = csr_.offsets[u];
+				const auto degree = csr_.offsets[u + 1] - first;
+				const auto total = std::accumulate(csr_.costs.begin() + static_cast<std::ptrdiff_t>(first),
+				                                   csr_.costs.begin() + static_cast<std::ptrdiff_t>(first + degree),
+				                                   0.0);
+				if (degree == 0) {
+					return;
+				}
+				if (not(total > 0.0)) {
+					stuck[u] = 1;
+					return;
+				}
+				auto small = std::vector<std::size_t>{};
+				auto large = std::vector<std::size_t>{};
+				for (auto arc = first; arc < first + degree; ++arc) {
+					accept_[arc] = csr_.costs[arc] * static_cast<double>(degree) / total;
+					(accept_[arc] < 1.0 ? small : large).push_back(arc);
+				}
+				while (not small.empty() and not large.empty()) {
+					const auto lo = small.back();
+					const auto hi = large.back();
+					small.pop_back();
+					alias_[lo] = hi;
+					accept_[hi] -= 1.0 - accept_[lo];
+					if (accept_[hi] < 1.0) {
+						large.pop_back();
+						small.push_back(hi);
+					}
+				}
+				// Whatever is left over is 1 up to rounding.
+				for (const auto arc : small) {
+					accept_[arc] = 1.0;
+				}
+				for (const auto arc : large) {
+					accept_[arc] = 1.0;
+				}
+			});
+			for (auto u = std::size_t{0}; u < csr_.size(); ++u) {
+				stuck_[u] = stuck[u] != 0;
+			}
+		}
+		// First-order step out of u.
+		auto sample(std::size_t u, detail::splitmix64& rng) const noexcept -> std::optional<std::size_t> {
+			const auto first = csr_.offsets[u];
+			const auto degree = csr_.offsets[u + 1] - first;
+			if (degree == 0 or (weighted_ and stuck_[u])) {
+				return std::nullopt;
+			}
+			auto arc = first + rng.below(degree);
+			if (weighted_ and rng.uniform() >= accept_[arc]) {
+				arc = alias_[arc];
+			}
+			return csr_.targets[arc];
+		}
+		[[nodiscard]] auto adjacent(std::size_t u, std::size_t v) const noexcept -> bool {
+			const auto first = csr_.targets.begin() + static_cast<std::ptrdiff_t>(csr_.offsets[u]);
+			const auto last = csr_.targets.begin() + static_cast<std::ptrdiff_t>(csr_.offsets[u + 1]);
+			return std::binary_search(first, last, v);
+		}
+		// Second-order node2vec step out of current, having arrived from previous.
+		auto sample(std::size_t previous,
+		            std::size_t current,
+		            const random_walk_options& options,
+		            detail::splitmix64& rng) const noexcept -> std::optional<std::size_t> {
+			if (options.p == 1.0 and options.q == 1.0) {
+				return sample(current, rng);
+			}
+			auto bias = [&](std::size_t next) {
+				return next == previous ? 1.0 / options.p : adjacent(previous, next) ? 1.0 : 1.0 / options.q;
+			};
+			const auto bound = std::max({1.0 / options.p, 1.0, 1.0 / options.q});
+			for (auto attempt = 0; attempt < 16; ++attempt) {
+				const auto next = sample(current, rng);
+				if (not next or rng.uniform() * bound < bias(*next)) {
+					return next;
+				}
+			}
+			// Rejection is slow when every neighbour has a small bias (e.g. a dead end back to previous with a
+			// large p), so draw exactly from the biased weights instead. Both paths sample the same distribution.
+			const auto first = csr_.offsets[current];
+			const auto last = csr_.offsets[current + 1];
+			auto total = 0.0;
+			for (auto arc = first; arc < last; ++arc) {
+				total += (weighted_ ? csr_.costs[arc] : 1.0) * bias(csr_.targets[arc]);
+			}
+			auto target = rng.uniform() * total;
+			for (auto arc = first; arc < last; ++arc) {
+				target -= (weighted_ ? csr_.costs[arc] : 1.0) * bias(csr_.targets[arc]);
+				if (target < 0.0) {
+					return csr_.targets[arc];
+				}
+			}
+			return csr_.targets[last - 1];
+		}
+	};
+	namespace detail {
+		// Like parallel_for, but hands out contiguous blocks so per-item work stays cheap: fn(worker, first, last).
+		template<typename F>
+		auto parallel_blocks(std::size_t count, std::size_t threads, F fn) -> void {
+			constexpr auto block = std::size_t{1024};
+			parallel_for((count + block - 1) / block, threads, [&](std::size_t worker, std::size_t i) {
+				fn(worker, i * block, std::min(count, (i + 1) * block));
+			});
+		}
+		inline auto hash_mix(std::uint64_t value) noexcept -> std::uint64_t {
+			return splitmix64{value}.next();
+		}
+		// Smallest-last (degeneracy) order: repeatedly removes a node of minimum remaining degree. Returns each
+		// node's removal position.
+		template<typename N>
+		auto smallest_last_order(const csr<N>& g) -> std::vector<std::size_t> {
+			const auto n = g.size();
+			auto degree = std::vector<std::size_t>(n);
+			auto buckets = std::vector<std::vector<std::size_t>>(n + 1);
+			for (auto v = std::size_t{0}; v < n; ++v) {
+				degree[v] = g.offsets[v + 1] - g.offsets[v];
+				buckets[degree[v]].push_back(v);
+			}
+			auto removed = std::vector<bool>(n, false);
+			auto position = std::vector<std::size_t>(n);
+			auto lowest = std::size_t{0};
+			for (auto next = std::size_t{0}; next < n;) {
+				if (buckets[lowest].empty()) {
+					++lowest;
+					continue;
+				}
+				const auto v = buckets[lowest].back();
+				buckets[lowest].pop_back();
+				// Stale entries are left behind whenever a node's degree drops.
+				if (removed[v] or degree[v] != lowest) {
+					continue;
+				}
+				removed[v] = true;
+				position[v] = next++;
+				for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+					const auto w = g.targets[arc];
+					if (not removed[w]) {
+						buckets[--degree[w]].push_back(w);
+					}
+				}
+				lowest = lowest == 0 ? 0 : lowest - 1;
+			}
+			return position;
+		}
+	} // namespace detail
+
+	enum class colouring_order {
+		// Jones-Plassmann with random priorities.
+		random,
+		// Priorities from the smallest-last ordering, which never needs more than degeneracy + 1 colours.
+		smallest_last,
+	};
+	struct colouring_options {
+		colouring_order order = colouring_order::random;
+		std::uint64_t seed = 0;
+		std::size_t threads = 0;
+	};
+	// Greedy colouring of the undirected interpretation of g (self loops ignored) with Jones-Plassmann rounds:
+	// every uncoloured node whose priority beats all its uncoloured neighbours takes the smallest colour unused
+	// around it. Such nodes are never adjacent, so each round colours them all in parallel. Colours count from 0.
+	template<typename N, typename E>
+	auto greedy_colouring(const graph<N, E>& g, const colouring_options& options = {})
+	    -> std::map<N, std::size_t> {
+		const auto csr = detail::undirected(detail::make_csr(g, detail::min_cost), detail::min_cost);
+		const auto n = csr.size();
+		auto priority = std::vector<std::uint64_t>(n);
+		if (options.order == colouring_order::smallest_last) {
+			const auto position = detail::smallest_last_order(csr);
+			std::copy(position.begin(), position.end(), priority.begin());
+		}
+		else {
+			for (auto v = std::size_t{0}; v < n; ++v) {
+				priority[v] = detail::hash_mix(options.seed ^ (0x2545f4914f6cdd1dULL * (v + 1)));
+			}
+		}
+		auto beats = [&](std::size_t v, std::size_t w) {
+			return priority[v] != priority[w] ? priority[v] > priority[w] : v > w;
+		};
+		const auto uncoloured = std::numeric_limits<std::size_t>::max();
+		auto colour = std::vector<std::size_t>(n, uncoloured);
+		auto pending = std::vector<std::size_t>(n);
+		std::iota(pending.begin(), pending.end(), std::size_t{0});
+		auto selected = std::vector<char>(n, 0);
+		const auto workers = detail::worker_count(options.threads, n);
+		auto used = std::vector<std::vector<char>>(workers);
+		while (not pending.empty()) {
+			detail::parallel_blocks(pending.size(), workers, [&](std::size_t, std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i) {
+					const auto v = pending[i];
+					auto local_max = true;
+					for (auto arc = csr.offsets[v]; arc < csr.offsets[v + 1] and local_max; ++arc) {
+						const auto w = csr.targets[arc];
+						local_max = colour[w] != uncoloured or beats(v, w);
+					}
+					selected[v] = local_max ? 1 : 0;
+				}
+			});
+			const auto assign = [&](std::size_t worker, std::size_t first, std::size_t last) {
+				auto& taken = used[worker];
+				for (auto i = first; i < last; ++i) {
+					const auto v = pending[i];
+					if (selected[v] == 0) {
+						continue;
+					}
+					const auto degree = csr.offsets[v + 1] - csr.offsets[v];
+					taken.assign(degree + 1, 0);
+					for (auto arc = csr.offsets[v]; arc < csr.offsets[v + 1]; ++arc) {
+						const auto c = colour[csr.targets[arc]];
+						if (c <= degree) {
+							taken[c] = 1;
+						}
+					}
+					colour[v] = static_cast<std::size_t>(std::find(taken.begin(), taken.end(), 0) - taken.begin());
+				}
+			};
+			detail::parallel_blocks(pending.size(), workers, assign);
+			pending.erase(
+			    std::remove_if(pending.begin(), pending.end(), [&](std::size_t v) { return selected[v] != 0; }),
+			    pending.end());
+		}
+		auto res = std::map<N, std::size_t>{};
+		for (auto v = std::size_t{0}; v < n; ++v) {
+			res.emplace_hint(res.end(), csr.nodes[v], colour[v]);
+		}
+		return res;
+	}
+
+	struct independent_set_options {
+		std::uint64_t seed = 0;
+		std::size_t threads = 0;
+	};
+	// Luby's randomised maximal independent set of the undirected interpretation of g (self loops ignored).
+	// Each round draws fresh priorities, every undecided node that beats all its undecided neighbours joins the
+	// set, and their neighbours drop out. Maps every node to whether it is in the set.
+	template<typename N, typename E>
+	auto maximal_independent_set(const graph<N, E>& g, const independent_set_options& options = {})
+	    -> std::map<N, bool> {
+		const auto csr = detail::undirected(detail::make_csr(g, detail::min_cost), detail::min_cost);
+		const auto n = csr.size();
+		enum state : char { undecided, in, out };
+		auto status = std::vector<char>(n, undecided);
+		auto selected = std::vector<char>(n, 0);
+		auto priority = std::vector<std::uint64_t>(n, 0);
+		auto pending = std::vector<std::size_t>(n);
+		std::iota(pending.begin(), pending.end(), std::size_t{0});
+		const auto workers = detail::worker_count(options.threads, n);
+		for (auto round = std::uint64_t{1}; not pending.empty(); ++round) {
+			const auto round_seed = detail::hash_mix(options.seed ^ round);
+			detail::parallel_blocks(pending.size(), workers, [&](std::size_t, std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i) {
+					priority[pending[i]] = detail::hash_mix(round_seed ^ (0x2545f4914f6cdd1dULL * (pending[i] + 1)));
+				}
+			});
+			detail::parallel_blocks(pending.size(), workers, [&](std::size_t, std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i) {
+					const auto v = pending[i];
+					auto local_max = true;
+					for (auto arc = csr.offsets[v]; arc < csr.offsets[v + 1] and local_max; ++arc) {
+						const auto w = csr.targets[arc];
+						local_max = status[w] != undecided
+						            or (priority[v] != priority[w] ? priority[v] > priority[w] : v > w);
+					}
+					selected[v] = local_max ? 1 : 0;
+				}
+			});
+			detail::parallel_blocks(pending.size(), workers, [&](std::size_t, std::size_t first, std::size_t last) {
+				for (auto i = first; i < last; ++i) {
+					const auto v = pending[i];
+					if (selected[v] != 0) {
+						status[v] = in;
+						continue;
+					}
+					for (auto arc = csr.offsets[v]; arc < csr.offsets[v + 1]; ++arc) {
+						if (selected[csr.targets[arc]] != 0) {
+							status[v] = out;
+							break;
+						}
+					}
+				}
+			});
+			pending.erase(
+			    std::remove_if(pending.begin(), pending.end(), [&](std::size_t v) { return status[v] != undecided; }),
+			    pending.end());
+		}
+		auto res = std::map<N, bool>{};
+		for (auto v = std::size_t{0}; v < n; ++v) {
+			res.emplace_hint(res.end(), csr.nodes[v], status[v] == in);
+		}
+		return res;
+	}
+	namespace detail {
+		// One multi-source BFS batch over W * 64 sources. Every node carries bitsets of the sources that have
+		// seen it and of those whose frontier it is on, so each level reads a node's arcs once for all sources.
+		template<std::size_t W>
+		struct ms_bfs_workspace {
+			using lanes = std::array<std::uint64_t, W>;
+			explicit ms_bfs_workspace(std::size_t n)
+			: seen(n)
+			, visit(n)
+			, next(n) {}
+			std::vector<lanes> seen;
+			std::vector<lanes> visit;
+			std::vector<lanes> next;
+			std::vector<std::size_t> frontier;
+			std::vector<std::size_t> touched;
+		};
+		template<std::size_t W, typename N, typename F>
+		auto ms_bfs_batch(const csr<N>& g,
+		                  const std::vector<std::size_t>& sources,
+		                  std::size_t first,
+		                  ms_bfs_workspace<W>& ws,
+		                  F& report) -> void {
+			using lanes = typename ms_bfs_workspace<W>::lanes;
+			const auto any = [](const lanes& bits) {
+				return std::any_of(bits.begin(), bits.end(), [](std::uint64_t word) { return word != 0; });
+			};
+			const auto for_each_lane = [&](const lanes& bits, std::size_t node, std::size_t hops) {
+				for (auto word = std::size_t{0}; word < W; ++word) {
+					for (auto rest = bits[word]; rest != 0; rest &= rest - 1) {
+						report(first + word * 64 + static_cast<std::size_t>(std::countr_zero(rest)), node, hops);
+					}
+				}
+			};
+			std::fill(ws.seen.begin(), ws.seen.end(), lanes{});
+			ws.frontier.clear();
+			const auto last = std::min(sources.size(), first + W * 64);
+			for (auto lane = std::size_t{0}; lane < last - first; ++lane) {
+				const auto s = sources[first + lane];
+				if (not any(ws.visit[s])) {
+					ws.frontier.push_back(s);
+				}
+				ws.seen[s][lane / 64] |= std::uint64_t{1} << (lane % 64);
+				ws.visit[s][lane / 64] |= std::uint64_t{1} << (lane % 64);
+			}
+			for (const auto s : ws.frontier) {
+				for_each_lane(ws.visit[s], s, 0);
+			}
+			for (auto hops = std::size_t{1}; not ws.frontier.empty(); ++hops) {
+				ws.touched.clear();
+				for (const auto v : ws.frontier) {
+					for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+						auto& next = ws.next[g.targets[arc]];
+						if (not any(next)) {
+							ws.touched.push_back(g.targets[arc]);
+						}
+						for (auto word = std::size_t{0}; word < W; ++word) {
+							next[word] |= ws.visit[v][word];
+						}
+					}
+				}
+				for (const auto v : ws.frontier) {
+					ws.visit[v] = lanes{};
+				}
+				ws.frontier.clear();
+				for (const auto w : ws.touched) {
+					auto fresh = lanes{};
+					for (auto word = std::size_t{0}; word < W; ++word) {
+						fresh[word] = ws.next[w][word] & ~ws.seen[w][word];
+						ws.seen[w][word] |= fresh[word];
+					}
+					ws.next[w] = lanes{};
+					if (any(fresh)) {
+						ws.visit[w] = fresh;
+						ws.frontier.push_back(w);
+						for_each_lane(fresh, w, hops);
+					}
+				}
+			}
+		}
+		template<std::size_t W, typename N, typename F>
+		auto ms_bfs_batches(const csr<N>& g, const std::vector<std::size_t>& sources, std::size_t threads, F& report)
+		    -> void {
+			const auto batches = (sources.size() + W * 64 - 1) / (W * 64);
+			const auto workers = worker_count(threads, batches);
+			auto workspaces = std::vector<ms_bfs_workspace<W>>{};
+			workspaces.reserve(workers);
+			for (auto worker = std::size_t{0}; worker < workers; ++worker) {
+				workspaces.emplace_back(g.size());
+			}
+			parallel_for(batches, workers, [&](std::size_t worker, std::size_t batch) {
+				ms_bfs_batch(g, sources, batch * W * 64, workspaces[worker], report);
+			});
+		}
+	} // namespace detail
+
+	struct multi_source_bfs_options {
+		// Sources searched together in one batch: 64 or 256.
+		std::size_t batch = 64;
+		// Batches run in parallel, so with more than one thread the callback must be thread-safe.
+		std::size_t threads = 1;
+	};
+	namespace detail {
+		// Runs the batches for the given source indices, calling report(lane, node, hops) with the position of
+		// the source in `sources`.
+		template<typename N, typename F>
+		auto ms_bfs(const csr<N>& g,
+		            const std::vector<std::size_t>& sources,
+		            const multi_source_bfs_options& options,
+		            F report) -> void {
+			if (options.batch == 64) {
+				ms_bfs_batches<1>(g, sources, options.threads, report);
+			}
+			else if (options.batch == 256) {
+				ms_bfs_batches<4>(g, sources, options.threads, report);
+			}
+			else {
+				throw std::runtime_error("Cannot call gdwg::multi_source_bfs with a batch other than 64 or 256");
+			}
+		}
+		template<typename N>
+		auto source_indices(const csr<N>& g, const std::vector<N>& sources) -> std::vector<std::size_t> {
+			auto res = std::vector<std::size_t>{};
+			res.reserve(sources.size());
+			for (const auto& source : sources) {
+				const auto index = g.index_of(source);
+				if (not index) {
+					throw std::runtime_error("Cannot call gdwg::multi_source_bfs from a node that doesn't exist in "
+					                         "the graph");
+				}
+				res.push_back(*index);
+			}
+			return res;
+		}
+	} // namespace detail
+	// Bit-parallel BFS along outgoing edges from every node in sources (Then et al., "The More the Merrier").
+	// Calls report(source, node, hops) once for every node reachable from each source, in non-decreasing hops
+	// per source, including (source, source, 0).
+	template<typename N, typename E, typename F>
+	auto multi_source_bfs(const graph<N, E>& g,
+	                      const std::vector<N>& sources,
+	                      F report,
+	                      const multi_source_bfs_options& options = {}) -> void {
+		const auto csr = detail::make_csr(g, detail::min_cost);
+		detail::ms_bfs(csr,
+		               detail::source_indices(csr, sources),
+		               options,
+		               [&](std::size_t lane, std::size_t node, std::size_t hops) {
+			               report(sources[lane], csr.nodes[node], hops);
+		               });
+	}
+	// Hop counts from each source to every node it reaches. Unreachable nodes are left out.
+	template<typename N, typename E>
+	auto hop_counts(const graph<N, E>& g, const std::vector<N>& sources, const multi_source_bfs_options& options = {})
+	    -> std::map<N, std::map<N, std::size_t>> {
+		const auto csr = detail::make_csr(g, detail::min_cost);
+		auto rows = std::vector<std::vector<std::pair<std::size_t, std::size_t>>>(sources.size());
+		// Each source belongs to exactly one batch, so its row is only ever written by one thread.
+		detail::ms_bfs(csr,
+		               detail::source_indices(csr, sources),
+		               options,
+		               [&](std::size_t lane, std::size_t node, std::size_t hops) {
+			               rows[lane].emplace_back(node, hops);
+		               });
+		auto res = std::map<N, std::map<N, std::size_t>>{};
+		for (auto i = std::size_t{0}; i < sources.size(); ++i) {
+			auto& row = res[sources[i]];
+			std::sort(rows[i].begin(), rows[i].end());
+			for (const auto& [node, hops] : rows[i]) {
+				row.emplace_hint(row.end(), csr.nodes[node], hops);
+			}
+		}
+		return res;
+	}
+	namespace detail {
+		struct cut_edge {
+			std::size_t u;
+			std::size_t v;
+			double weight;
+		};
+		// Stoer-Wagner on vertices [0, k). Each phase grows a maximum adjacency order with a lazy max-heap and
+		// merges the last two vertices; the lightest cut-of-the-phase is the minimum cut. Returns its weight and
+		// which vertices are on the side of the merged vertex that produced it.
+		inline auto stoer_wagner(std::size_t k, const std::vector<cut_edge>& edges)
+		    -> std::pair<double, std::vector<bool>> {
+			auto adjacency = std::vector<std::unordered_map<std::size_t, double>>(k);
+			for (const auto& [u, v, weight] : edges) {
+				if (u != v) {
+					adjacency[u][v] += weight;
+					adjacency[v][u] += weight;
+				}
+			}
+			auto members = std::vector<std::vector<std::size_t>>(k);
+			auto alive = std::vector<std::size_t>(k);
+			for (auto v = std::size_t{0}; v < k; ++v) {
+				members[v].push_back(v);
+				alive[v] = v;
+			}
+			auto best = std::numeric_limits<double>::infinity();
+			auto best_side = std::vector<std::size_t>{};
+			auto key = std::vector<double>(k, 0.0);
+			auto added = std::vector<bool>(k, false);
+			using entry = std::pair<double, std::size_t>;
+			while (alive.size() > 1) {
+				for (const auto v : alive) {
+					key[v] = 0.0;
+					added[v] = false;
+				}
+				auto heap = std::priority_queue<entry>{};
+				auto scan = std::size_t{0};
+				auto previous = alive.front();
+				auto last = alive.front();
+				for (auto count = std::size_t{0}; count < alive.size(); ++count) {
+					auto v = alive.front();
+					while (not heap.empty()) {
+						const auto [top_key, top] = heap.top();
+						if (not added[top] and top_key == key[top]) {
+							break;
+						}
+						heap.pop();
+					}
+					if (heap.empty()) {
+						// Nothing left is attached to the order so far: take any vertex at key 0.
+						while (added[alive[scan]]) {
+							++scan;
+						}
+						v = alive[scan];
+					}
+					else {
+						v = heap.top().second;
+						heap.pop();
+					}
+					added[v] = true;
+					previous = last;
+					last = v;
+					for (const auto& [w, weight] : adjacency[v]) {
+						if (not added[w]) {
+							key[w] += weight;
+							heap.emplace(key[w], w);
+						}
+					}
+				}
+				if (key[last] < best) {
+					best = key[last];
+					best_side = members[last];
+				}
+				// Merge last into previous.
+				for (const auto& [w, weight] : adjacency[last]) {
+					adjacency[w].erase(last);
+					if (w != previous) {
+						adjacency[previous][w] += weight;
+						adjacency[w][previous] += weight;
+					}
+				}
+				adjacency[last].clear();
+				members[previous].insert(members[previous].end(), members[last].begin(), members[last].end());
+				alive.erase(std::find(alive.begin(), alive.end(), last));
+			}
+			auto side = std::vector<bool>(k, false);
+			for (const auto v : best_side) {
+				side[v] = true;
+			}
+			return {best, std::move(side)};
+		}
+		// Contracts random edges, picked with probability proportional to weight, until `target` vertices are
+		// left. Sorting by exponential keys -ln(U) / w and contracting in that order is equivalent to repeatedly
+		// drawing a weighted random edge. Returns the new label of every vertex and the number of labels.
+		inline auto contract(std::size_t k,
+		                     const std::vector<cut_edge>& edges,
+		                     std::size_t target,
+		                     std::mt19937_64& rng) -> std::pair<std::vector<std::size_t>, std::size_t> {
+			auto order = std::vector<std::pair<double, std::size_t>>{};
+			auto uniform = std::uniform_real_distribution<double>{0.0, 1.0};
+			for (auto i = std::size_t{0}; i < edges.size(); ++i) {
+				if (edges[i].weight > 0.0) {
+					order.emplace_back(-std::log1p(-uniform(rng)) / edges[i].weight, i);
+				}
+			}
+			std::sort(order.begin(), order.end());
+			auto parent = std::vector<std::size_t>(k);
+			std::iota(parent.begin(), parent.end(), std::size_t{0});
+			auto find = [&](std::size_t v) {
+				while (parent[v] != v) {
+					v = parent[v] = parent[parent[v]];
+				}
+				return v;
+			};
+			auto components = k;
+			for (auto it = order.begin(); it != order.end() and components > target; ++it) {
+				const auto a = find(edges[it->second].u);
+				const auto b = find(edges[it->second].v);
+				if (a != b) {
+					parent[a] = b;
+					--components;
+				}
+			}
+			auto label = std::vector<std::size_t>(k, k);
+			auto res = std::vector<std::size_t>(k);
+			auto count = std::size_t{0};
+			for (auto v = std::size_t{0}; v < k; ++v) {
+				auto& root = label[find(v)];
+				if (root == k) {
+					root = count++;
+				}
+				res[v] = root;
+			}
+			return {std::move(res), count};
+		}
+		// Recursive Karger-Stein: contract to about k / sqrt(2) vertices twice independently, recurse on both and
+		// keep the lighter cut. Small graphs are finished exactly with Stoer-Wagner.
+		inline auto karger_stein(std::size_t k, const std::vector<cut_edge>& edges, std::mt19937_64& rng)
+		    -> std::pair<double, std::vector<bool>> {
+			if (k <= 6) {
+				return stoer_wagner(k, edges);
+			}
+			const auto target = static_cast<std::size_t>(std::ceil(1.0 + static_cast<double>(k) / std::sqrt(2.0)));
+			auto best = std::pair<double, std::vector<bool>>{std::numeric_limits<double>::infinity(), {}};
+			for (auto attempt = 0; attempt < 2; ++attempt) {
+				const auto [label, count] = contract(k, edges, target, rng);
+				auto side = std::vector<bool>(k, false);
+				if (count > target) {
+					// Ran out of positive edges: some component is cut off at no cost.
+					for (auto v = std::size_t{0}; v < k; ++v) {
+						side[v] = label[v] == label[0];
+					}
+					return {0.0, std::move(side)};
+				}
+				auto merged = std::map<std::pair<std::size_t, std::size_t>, double>{};
+				for (const auto& [u, v, weight] : edges) {
+					const auto a = std::min(label[u], label[v]);
+					const auto b = std::max(label[u], label[v]);
+					if (a != b) {
+						merged[{a, b}] += weight;
+					}
+				}
+				auto contracted = std::vector<cut_edge>{};
+				contracted.reserve(merged.size());
+				for (const auto& [pair, weight] : merged) {
+					contracted.push_back({pair.first, pair.second, weight});
+				}
+				const auto [weight, contracted_side] = karger_stein(count, contracted, rng);
+				if (weight < best.first) {
+					for (auto v = std::size_t{0}; v < k; ++v) {
+						side[v] = contracted_side[label[v]];
+					}
+					best = {weight, std::move(side)};
+				}
+			}
+			return best;
+		}
+		// The undirected interpretation of g as a list of u < v edges, weighted by the sum of the edges between
+		// u and v in either direction.
+		template<typename N, typename E>
+		auto cut_edges(const graph<N, E>& g, const std::string& caller) -> std::pair<csr<N>, std::vector<cut_edge>> {
+			auto csr = undirected(make_csr(g, sum_cost), sum_cost);
+			if (csr.size() < 2) {
+				throw std::runtime_error("Cannot call gdwg::" + caller + " on a graph with fewer than two nodes");
+			}
+			auto edges = std::vector<cut_edge>{};
+			for (auto u = std::size_t{0}; u < csr.size(); ++u) {
+				for (auto arc = csr.offsets[u]; arc < csr.offsets[u + 1]; ++arc) {
+					if (csr.costs[arc] < 0.0) {
+						throw std::runtime_error("Cannot call gdwg::" + caller
+						                         + " on a graph with negative edge weights");
+					}
+					if (u < csr.targets[arc]) {
+						edges.push_back({u, csr.targets[arc], csr.costs[arc]});
+					}
+				}
+			}
+			return {std::move(csr), std::move(edges)};
+		}
+	} // namespace detail
+
+	template<typename N>
+	struct cut {
+		double weight = 0.0;
+		std::set<N> first;
+		std::set<N> second;
+	};
+	namespace detail {
+		template<typename N>
+		auto to_cut(const csr<N>& g, double weight, const std::vector<bool>& side) -> cut<N> {
+			auto res = cut<N>{weight, {}, {}};
+			for (auto v = std::size_t{0}; v < g.size(); ++v) {
+				auto& part = side[v] ? res.first : res.second;
+				part.emplace_hint(part.end(), g.nodes[v]);
+			}
+			return res;
+		}
+	} // namespace detail
+	// Deterministic global minimum cut of the undirected interpretation of g, where the weight between two nodes
+	// is the sum of the edges between them in either direction (unweighted edges count as 1).
+	template<typename N, typename E>
+	auto stoer_wagner_min_cut(const graph<N, E>& g) -> cut<N> {
+		const auto [csr, edges] = detail::cut_edges(g, "stoer_wagner_min_cut");
+		const auto [weight, side] = detail::stoer_wagner(csr.size(), edges);
+		return detail::to_cut(csr, weight, side);
+	}
+	struct karger_stein_options {
+		// Independent trials; 0 means ceil(log2(n))^2, which finds the minimum cut with high probability.
+		std::size_t trials = 0;
+		std::uint64_t seed = 0;
+		std::size_t threads = 0;
+	};
+	// Randomised global minimum cut of the same undirected interpretation as stoer_wagner_min_cut. Trials run in
+	// parallel, each from its own seed, and the lightest cut wins (ties go to the earliest trial), so the result
+	// does not depend on the thread count.
+	template<typename N, typename E>
+	auto karger_stein_min_cut(const graph<N, E>& g, const karger_stein_options& options = {}) -> cut<N> {
+		const auto input = detail::cut_edges(g, "karger_stein_min_cut");
+		const auto& edges = input.second;
+		const auto n = input.first.size();
+		const auto log_n = static_cast<std::size_t>(std::ceil(std::log2(static_cast<double>(n))));
+		const auto trials = options.trials != 0 ? options.trials : std::max(std::size_t{1}, log_n * log_n);
+		auto results = std::vector<std::pair<double, std::vector<bool>>>(trials);
+		detail::parallel_for(trials, options.threads, [&](std::size_t, std::size_t trial) {
+			auto rng = std::mt19937_64{detail::hash_mix(options.seed ^ (0x2545f4914f6cdd1dULL * (trial + 1)))};
+			results[trial] = detail::karger_stein(n, edges, rng);
+		});
+		const auto best = std::min_element(results.begin(), results.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.first < rhs.first;
+		});
+		return detail::to_cut(input.first, best->first, best->second);
+	}
+	namespace detail {
+		inline auto max_cost(double lhs, double rhs) -> double {
+			return std::max(lhs, rhs);
+		}
+		// The bipartite view of g for a caller-given left side: left[i] is the node index of left vertex i and
+		// row i lists the right-side node indices it shares an edge with, in either direction, together with the
+		// heaviest such edge.
+		template<typename N>
+		struct bipartite {
+			csr<N> nodes;
+			std::vector<std::size_t> left;
+			std::vector<std::vector<std::pair<std::size_t, double>>> rows;
+		};
+		template<typename N, typename E>
+		auto make_bipartite(const graph<N, E>& g, const std::vector<N>& left, const std::string& caller)
+		    -> bipartite<N> {
+			auto res = bipartite<N>{undirected(make_csr(g, max_cost), max_cost), {}, {}};
+			auto on_left = std::vector<bool>(res.nodes.size(), false);
+			for (const auto& node : left) {
+				const auto index = res.nodes.index_of(node);
+				if (not index) {
+					throw std::runtime_error("Cannot call gdwg::" + caller + " with a node that doesn't exist in the "
+					                         "graph");
+				}
+				if (not on_left[*index]) {
+					on_left[*index] = true;
+					res.left.push_back(*index);
+				}
+			}
+			res.rows.resize(res.left.size());
+			for (auto i = std::size_t{0}; i < res.left.size(); ++i) {
+				const auto u = res.left[i];
+				for (auto arc = res.nodes.offsets[u]; arc < res.nodes.offsets[u + 1]; ++arc) {
+					if (not on_left[res.nodes.targets[arc]]) {
+						res.rows[i].emplace_back(res.nodes.targets[arc], res.nodes.costs[arc]);
+					}
+				}
+			}
+			return res;
+		}
+		template<typename N>
+		auto to_matching(const bipartite<N>& b, const std::vector<std::size_t>& partner) -> std::map<N, N> {
+			auto res = std::map<N, N>{};
+			for (auto i = std::size_t{0}; i < b.left.size(); ++i) {
+				if (partner[i] != b.nodes.size()) {
+					res.emplace(b.nodes.nodes[b.left[i]], b.nodes.nodes[partner[i]]);
+				}
+			}
+			return res;
+		}
+	} // namespace detail
+
+	// Hopcroft-Karp maximum-cardinality matching between the given left nodes and all other nodes. An edge in
+	// either direction between a left and a right node may be matched; edges within one side are ignored.
+	// Returns each matched left node's partner.
+	template<typename N, typename E>
+	auto maximum_bipartite_matching(const graph<N, E>& g, const std::vector<N>& left) -> std::map<N, N> {
+		const auto b = detail::make_bipartite(g, left, "maximum_bipartite_matching");
+		const auto n = b.nodes.size();
+		const auto nl = b.left.size();
+		const auto none = std::numeric_limits<std::size_t>::max();
+		// match_left is indexed by left vertex, match_right by node index; n marks "unmatched".
+		auto match_left = std::vector<std::size_t>(nl, n);
+		auto match_right = std::vector<std::size_t>(n, none);
+		auto dist = std::vector<std::size_t>(nl);
+		auto next_arc = std::vector<std::size_t>(nl);
+		auto queue = std::vector<std::size_t>{};
+		auto stack = std::vector<std::size_t>{};
+		auto via = std::vector<std::size_t>{};
+		for (;;) {
+			// Layer the left vertices by alternating-path distance from the free ones.
+			queue.clear();
+			for (auto i = std::size_t{0}; i < nl; ++i) {
+				dist[i] = match_left[i] == n ? 0 : none;
+				if (dist[i] == 0) {
+					queue.push_back(i);
+				}
+			}
+			// The layering stops at the first layer that reaches a free right vertex, so that every path the
+			// phase augments is a shortest one.
+			auto limit = none;
+			for (auto head = std::size_t{0}; head < queue.size() and dist[queue[head]] <= limit; ++head) {
+				const auto i = queue[head];
+				for (const auto& [r, weight] : b.rows[i]) {
+					const auto j = match_right[r];
+					if (j == none) {
+						limit = dist[i];
+					}
+					else if (dist[j] == none and limit == none) {
+						dist[j] = dist[i] + 1;
+						queue.push_back(j);
+					}
+				}
+			}
+			if (limit == none) {
+				break;
+			}
+			// Vertex-disjoint shortest augmenting paths along the layers, by iterative DFS.
+			std::fill(next_arc.begin(), next_arc.end(), 0);
+			for (auto root = std::size_t{0}; root < nl; ++root) {
+				if (match_left[root] != n) {
+					continue;
+				}
+				stack.assign(1, root);
+				via.clear();
+				while (not stack.empty()) {
+					const auto i = stack.back();
+					if (next_arc[i] == b.rows[i].size()) {
+						dist[i] = none;
+						stack.pop_back();
+						if (not via.empty()) {
+							via.pop_back();
+						}
+						continue;
+					}
+					const auto r = b.rows[i][next_arc[i]++].first;
+					const auto j = match_right[r];
+					if (j == none and dist[i] == limit) {
+						via.push_back(r);
+						for (auto level = std::size_t{0}; level < stack.size(); ++level) {
+							match_left[stack[level]] = via[level];
+							match_right[via[level]] = stack[level];
+						}
+						break;
+					}
+					if (j != none and dist[j] == dist[i] + 1 and dist[j] <= limit) {
+						via.push_back(r);
+						stack.push_back(j);
+					}
+				}
+			}
+		}
+		return detail::to_matching(b, match_left);
+	}
+
+	struct auction_options {
+		// Minimum bid increment. The matching is within |left| * epsilon of the maximum weight; 0 picks
+		// 1 / (|left| + 1), which is exact for integer weights. Larger values trade accuracy for fewer rounds.
+		double epsilon = 0.0;
+		std::size_t threads = 0;
+	};
+	// Maximum-weight bipartite matching by Bertsekas' forward auction algorithm. The weight of a left-right pair
+	// is its heaviest edge in either direction; pairs of non-positive weight are never matched. Unassigned left
+	// nodes bid in parallel (Jacobi bidding) and each right node then takes its highest bid.
+	template<typename N, typename E>
+	auto maximum_weight_matching(const graph<N, E>& g, const std::vector<N>& left, const auction_options& options = {})
+	    -> std::map<N, N> {
+		static_assert(std::is_arithmetic_v<E>, "maximum_weight_matching needs arithmetic edge weights");
+		const auto b = detail::make_bipartite(g, left, "maximum_weight_matching");
+		const auto n = b.nodes.size();
+		const auto nl = b.left.size();
+		const auto epsilon = options.epsilon > 0.0 ? options.epsilon : 1.0 / static_cast<double>(nl + 1);
+		auto price = std::vector<double>(n, 0.0);
+		auto owner = std::vector<std::size_t>(n, nl);
+		auto partner = std::vector<std::size_t>(nl, n);
+		// The bid of each bidder: target node (n for none) and offered price.
+		auto bids = std::vector<std::pair<std::size_t, double>>(nl);
+		auto bidders = std::vector<std::size_t>(nl);
+		auto next = std::vector<std::size_t>{};
+		auto touched = std::vector<std::size_t>{};
+		auto best_bid = std::vector<std::size_t>(n, nl);
+		std::iota(bidders.begin(), bidders.end(), std::size_t{0});
+		// Prices start at 0 and only rise on bids, so right nodes nobody bid for stay at 0. That keeps the
+		// asymmetric problem optimal without a reverse auction, at the cost of forgoing epsilon scaling.
+		const auto bid = [&](std::size_t, std::size_t first, std::size_t last) {
+			for (auto k = first; k < last; ++k) {
+				const auto i = bidders[k];
+				// Staying unmatched is always worth 0.
+				auto best = n;
+				auto best_value = 0.0;
+				auto second_value = 0.0;
+				for (const auto& [r, weight] : b.rows[i]) {
+					const auto value = weight - price[r];
+					if (value > best_value) {
+						second_value = best_value;
+						best_value = value;
+						best = r;
+					}
+					else if (value > second_value) {
+						second_value = value;
+					}
+				}
+				bids[i] = {best, best == n ? 0.0 : price[best] + best_value - second_value + epsilon};
+			}
+		};
+		while (not bidders.empty()) {
+			detail::parallel_blocks(bidders.size(), options.threads, bid);
+			// Each right node takes its highest bid (the earliest on ties); everyone outbid bids again.
+			touched.clear();
+			next.clear();
+			for (const auto i : bidders) {
+				const auto r = bids[i].first;
+				if (r == n) {
+					continue;
+				}
+				if (best_bid[r] == nl) {
+					touched.push_back(r);
+					best_bid[r] = i;
+				}
+				else if (bids[i].second > bids[best_bid[r]].second) {
+					next.push_back(best_bid[r]);
+					best_bid[r] = i;
+				}
+				else {
+					next.push_back(i);
+				}
+			}
+			for (const auto r : touched) {
+				const auto winner = best_bid[r];
+				best_bid[r] = nl;
+				if (owner[r] != nl) {
+					partner[owner[r]] = n;
+					next.push_back(owner[r]);
+				}
+				owner[r] = winner;
+				partner[winner] = r;
+				price[r] = bids[winner].second;
+			}
+			bidders.swap(next);
+		}
+		return detail::to_matching(b, partner);
+	}
+	enum class eulerian {
+		none,
+		// A trail that uses every edge once and ends somewhere other than where it starts.
+		path,
+		// A closed trail that uses every edge once.
+		circuit,
+	};
+	namespace detail {
+		// Every edge of g as a separate arc, parallel edges included, in the usual node and edge order.
+		template<typename N, typename E>
+		auto multi_arcs(const graph<N, E>& g) -> std::pair<std::vector<N>, std::vector<std::vector<std::size_t>>> {
+			auto index = std::unordered_map<const N*, std::size_t>{};
+			auto nodes = std::vector<N>{};
+			for (const auto& node : graph_access::nodes(g)) {
+				index.emplace(node.get(), nodes.size());
+				nodes.push_back(*node);
+			}
+			auto arcs = std::vector<std::vector<std::size_t>>(nodes.size());
+			for (const auto& [src, dst_set] : graph_access::edges(g)) {
+				auto& row = arcs[index.at(src.get())];
+				for (const auto& edge : dst_set) {
+					row.push_back(index.at(edge.first.get()));
+				}
+			}
+			return {std::move(nodes), std::move(arcs)};
+		}
+		// Degree balance and weak connectivity of the nodes that have edges. Returns the kind and, when there is
+		// one, where an Eulerian trail has to start.
+		inline auto classify_eulerian(const std::vector<std::vector<std::size_t>>& arcs)
+		    -> std::pair<eulerian, std::size_t> {
+			const auto n = arcs.size();
+			auto balance = std::vector<std::ptrdiff_t>(n, 0);
+			auto parent = std::vector<std::size_t>(n);
+			std::iota(parent.begin(), parent.end(), std::size_t{0});
+			auto find = [&](std::size_t v) {
+				while (parent[v] != v) {
+					v = parent[v] = parent[parent[v]];
+				}
+				return v;
+			};
+			auto start = n;
+			for (auto u = std::size_t{0}; u < n; ++u) {
+				for (const auto v : arcs[u]) {
+					++balance[u];
+					--balance[v];
+					parent[find(u)] = find(v);
+				}
+				if (start == n and not arcs[u].empty()) {
+					start = u;
+				}
+			}
+			if (start == n) {
+				return {eulerian::circuit, n};
+			}
+			auto sources = 0;
+			auto sinks = 0;
+			for (auto v = std::size_t{0}; v < n; ++v) {
+				const auto with_edges = not arcs[v].empty() or balance[v] != 0;
+				if (with_edges and find(v) != find(start)) {
+					return {eulerian::none, n};
+				}
+				if (balance[v] == 1) {
+					++sources;
+					start = v;
+				}
+				else if (balance[v] == -1) {
+					++sinks;
+				}
+				else if (balance[v] != 0) {
+					return {eulerian::none, n};
+				}
+			}
+			if (sources == 0 and sinks == 0) {
+				return {eulerian::circuit, start};
+			}
+			if (sources == 1 and sinks == 1) {
+				return {eulerian::path, start};
+			}
+			return {eulerian::none, n};
+		}
+	} // namespace detail
+
+	// Whether g has a trail that uses every edge exactly once (parallel edges are separate edges). A graph
+	// without edges has the empty circuit.
+	template<typename N, typename E>
+	auto eulerian_kind(const graph<N, E>& g) -> eulerian {
+		return detail::classify_eulerian(detail::multi_arcs(g).second).first;
+	}
+	// An Eulerian trail as its sequence of nodes, by iterative Hierholzer. It is a circuit when the first and last
+	// nodes are the same. Empty when g has no edges; nullopt when no such trail exists.
+	template<typename N, typename E>
+	auto eulerian_path(const graph<N, E>& g) -> std::optional<std::vector<N>> {
+		const auto [nodes, arcs] = detail::multi_arcs(g);
+		const auto [kind, start] = detail::classify_eulerian(arcs);
+		if (kind == eulerian::none) {
+			return std::nullopt;
+		}
+		auto res = std::vector<N>{};
+		if (start == nodes.size()) {
+			return res;
+		}
+		auto next_arc = std::vector<std::size_t>(nodes.size(), 0);
+		auto stack = std::vector<std::size_t>{start};
+		auto trail = std::vector<std::size_t>{};
+		while (not stack.empty()) {
+			const auto v = stack.back();
+			if (next_arc[v] < arcs[v].size()) {
+				stack.push_back(arcs[v][next_arc[v]++]);
+			}
+			else {
+				trail.push_back(v);
+				stack.pop_back();
+			}
+		}
+		res.reserve(trail.size());
+		for (auto it = trail.rbegin(); it != trail.rend(); ++it) {
+			res.push_back(nodes[*it]);
+		}
+		return res;
+	}
+
+	struct cycle_options {
+		// Longest cycle to report, in nodes; 0 means no limit.
+		std::size_t max_length = 0;
+		// Stop after this many cycles; 0 means no limit.
+		std::size_t max_cycles = 0;
+	};
+	// Johnson's enumeration of the elementary cycles of g, parallel edges counting once. Each cycle is passed to
+	// callback as its nodes starting from the smallest one, without repeating it at the end; a callback that
+	// returns bool stops the enumeration by returning false. Cycles are streamed as they are found, so memory
+	// stays linear in the size of the graph however many there are. Returns the number of cycles reported.
+	//
+	// With max_length set, a search cut short by the limit never blocks its node, which keeps Johnson's
+	// blocking sound at the cost of some repeated work.
+	template<typename N, typename E, typename F>
+	auto for_each_cycle(const graph<N, E>& g, F callback, const cycle_options& options = {}) -> std::size_t {
+		const auto csr = detail::make_csr(g, detail::min_cost);
+		const auto n = csr.size();
+		const auto limit = options.max_length == 0 ? n : options.max_length;
+		auto reverse = std::vector<std::vector<std::size_t>>(n);
+		for (auto u = std::size_t{0}; u < n; ++u) {
+			for (auto arc = csr.offsets[u]; arc < csr.offsets[u + 1]; ++arc) {
+				reverse[csr.targets[arc]].push_back(u);
+			}
+		}
+		// Marks are stamped with the current start so nothing needs clearing between starts.
+		const auto none = std::numeric_limits<std::size_t>::max();
+		auto forward_mark = std::vector<std::size_t>(n, none);
+		auto component_mark = std::vector<std::size_t>(n, none);
+		auto blocked = std::vector<bool>(n, false);
+		auto blockers = std::vector<std::vector<std::size_t>>(n);
+		auto path = std::vector<std::size_t>{};
+		auto frames = std::vector<std::tuple<std::size_t, std::size_t, bool>>{};
+		auto work = std::vector<std::size_t>{};
+		auto cycle = std::vector<N>{};
+		auto count = std::size_t{0};
+		auto unblock = [&](std::size_t v) {
+			work.assign(1, v);
+			while (not work.empty()) {
+				const auto x = work.back();
+				work.pop_back();
+				if (blocked[x]) {
+					blocked[x] = false;
+					work.insert(work.end(), blockers[x].begin(), blockers[x].end());
+					blockers[x].clear();
+				}
+			}
+		};
+		// Returns false once the callback or max_cycles asks to stop.
+		auto emit = [&]() {
+			cycle.clear();
+			for (const auto v : path) {
+				cycle.push_back(csr.nodes[v]);
+			}
+			++count;
+			auto more = true;
+			if constexpr (std::is_same_v<std::invoke_result_t<F&, const std::vector<N>&>, bool>) {
+				more = callback(static_cast<const std::vector<N>&>(cycle));
+			}
+			else {
+				callback(static_cast<const std::vector<N>&>(cycle));
+			}
+			return more and (options.max_cycles == 0 or count < options.max_cycles);
+		};
+		for (auto s = std::size_t{0}; s < n; ++s) {
+			// The strongly connected component of s among the nodes >= s: reachable both ways from s.
+			work.assign(1, s);
+			forward_mark[s] = s;
+			while (not work.empty()) {
+				const auto v = work.back();
+				work.pop_back();
+				for (auto arc = csr.offsets[v]; arc < csr.offsets[v + 1]; ++arc) {
+					const auto w = csr.targets[arc];
+					if (w > s and forward_mark[w] != s) {
+						forward_mark[w] = s;
+						work.push_back(w);
+					}
+				}
+			}
+			work.assign(1, s);
+			component_mark[s] = s;
+			while (not work.empty()) {
+				const auto v = work.back();
+				work.pop_back();
+				blocked[v] = false;
+				blockers[v].clear();
+				for (const auto w : reverse[v]) {
+					if (w > s and forward_mark[w] == s and component_mark[w] != s) {
+						component_mark[w] = s;
+						work.push_back(w);
+					}
+				}
+			}
+			path.assign(1, s);
+			blocked[s] = true;
+			frames.assign(1, {s, csr.offsets[s], false});
+			while (not frames.empty()) {
+				auto& [v, arc, found] = frames.back();
+				if (arc < csr.offsets[v + 1]) {
+					const auto w = csr.targets[arc++];
+					if (component_mark[w] != s) {
+						continue;
+					}
+					if (w == s) {
+						found = true;
+						if (not emit()) {
+							return count;
+						}
+					}
+					else if (not blocked[w]) {
+						if (path.size() < limit) {
+							path.push_back(w);
+							blocked[w] = true;
+							frames.emplace_back(w, csr.offsets[w], false);
+						}
+						else {
+							found = true;
+						}
+					}
+					continue;
+				}
+				const auto done = v;
+				const auto done_found = found;
+				if (done_found) {
+					unblock(done);
+				}
+				else {
+					for (auto a = csr.offsets[done]; a < csr.offsets[done + 1]; ++a) {
+						const auto w = csr.targets[a];
+						if (component_mark[w] == s
+						    and std::find(blockers[w].begin(), blockers[w].end(), done) == blockers[w].end())
+						{
+							blockers[w].push_back(done);
+						}
+					}
+				}
+				frames.pop_back();
+				path.pop_back();
+				if (not frames.empty() and done_found) {
+					std::get<2>(frames.back()) = true;
+				}
+			}
+		}
+		return count;
+	}
+	enum class dominance {
+		// Every path from the root to a node passes through its dominators.
+		dominators,
+		// Every path from a node to the root (an exit node) passes through its post-dominators.
+		post_dominators,
+	};
+	template<typename N>
+	class dominator_tree {
+	 public:
+		static constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+		template<typename E>
+		dominator_tree(const graph<N, E>& g, const N& root, dominance kind = dominance::dominators) {
+			const auto csr = detail::make_csr(g, detail::min_cost);
+			const auto start = csr.index_of(root);
+			if (not start) {
+				throw std::runtime_error("Cannot call gdwg::dominator_tree<N>::dominator_tree if root node doesn't "
+				                         "exist in the graph");
+			}
+			nodes_ = csr.nodes;
+			const auto n = csr.size();
+			// Post-dominators are dominators of the reversed graph, so only the arc direction changes.
+			auto offsets = std::vector<std::size_t>(n + 1, 0);
+			auto targets = std::vector<std::size_t>(csr.targets.size());
+			auto reverse_offsets = std::vector<std::size_t>(n + 1, 0);
+			auto reverse_targets = std::vector<std::size_t>(csr.targets.size());
+			for (const auto v : csr.targets) {
+				++reverse_offsets[v + 1];
+			}
+			std::partial_sum(reverse_offsets.begin(), reverse_offsets.end(), reverse_offsets.begin());
+			auto fill = std::vector<std::size_t>(reverse_offsets.begin(), reverse_offsets.end() - 1);
+			for (auto u = std::size_t{0}; u < n; ++u) {
+				for (auto arc = csr.offsets[u]; arc < csr.offsets[u + 1]; ++arc) {
+					reverse_targets[fill[csr.targets[arc]]++] = u;
+				}
+			}
+			if (kind == dominance::dominators) {
+				offsets = csr.offsets;
+				targets = csr.targets;
+			}
+			else {
+				offsets.swap(reverse_offsets);
+				targets.swap(reverse_targets);
+				reverse_offsets = csr.offsets;
+				reverse_targets = csr.targets;
+			}
+			build(*start, offsets, targets, reverse_offsets, reverse_targets);
+			label_intervals(*start);
+		}
+
+		[[nodiscard]] auto root() const noexcept -> const N& {
+			return nodes_[root_];
+		}
+		// Nodes in sorted order; parents()[i] is the immediate dominator of nodes()[i].
+		[[nodiscard]] auto nodes() const noexcept -> const std::vector<N>& {
+			return nodes_;
+		}
+		// The root is its own parent and nodes unreachable from the root have parent npos.
+		[[nodiscard]] auto parents() const noexcept -> const std::vector<std::size_t>& {
+			return parent_;
+		}
+		[[nodiscard]] auto reachable(const N& node) const -> bool {
+			return parent_[index_of(node, "reachable")] != npos;
+		}
+		[[nodiscard]] auto immediate_dominator(const N& node) const -> std::optional<N> {
+			const auto i = index_of(node, "immediate_dominator");
+			if (i == root_ or parent_[i] == npos) {
+				return std::nullopt;
+			}
+			return nodes_[parent_[i]];
+		}
+		// Reflexive: every reachable node dominates itself. Nothing dominates or is dominated by an unreachable
+		// node.
+		[[nodiscard]] auto dominates(const N& a, const N& b) const -> bool {
+			const auto i = index_of(a, "dominates");
+			const auto j = index_of(b, "dominates");
+			if (parent_[i] == npos or parent_[j] == npos) {
+				return false;
+			}
+			return pre_[i] <= pre_[j] and post_[j] <= post_[i];
+		}
+
+	 private:
+		std::vector<N> nodes_;
+		std::size_t root_ = 0;
+		std::vector<std::size_t> parent_;
+		std::vector<std::size_t> pre_;
+		std::vector<std::size_t> post_;
+
+		[[nodiscard]] auto index_of(const N& node, const char* caller) const -> std::size_t {
+			const auto it = std::lower_bound(nodes_.begin(), nodes_.end(), node);
+			if (it == nodes_.end() or *it != node) {
+				throw std::runtime_error(std::string("Cannot call gdwg::dominator_tree<N>::") + caller
+				                         + " if node doesn't exist in the graph");
+			}
+			return static_cast<std::size_t>(it - nodes_.begin());
+		}
+		// Lengauer-Tarjan with path compression. Everything below works on DFS preorder numbers, so a smaller
+		// number is always an ancestor candidate and semidominators compare directly.
+		auto build(std::size_t start,
+		           const std::vector<std::size_t>& offsets,
+		           const std::vector<std::size_t>& targets,
+		           const std::vector<std::size_t>& reverse_offsets,
+		           const std::vector<std::size_t>& reverse_targets) -> void {
+			const auto n = nodes_.size();
+			root_ = start;
+			auto number = std::vector<std::size_t>(n, npos);
+			auto vertex = std::vector<std::size_t>{};
+			auto tree_parent = std::vector<std::size_t>{};
+			vertex.reserve(n);
+			tree_parent.reserve(n);
+			auto frames = std::vector<std::pair<std::size_t, std::size_t>>{{start, offsets[start]}};
+			number[start] = 0;
+			vertex.push_back(start);
+			tree_parent.push_back(0);
+			while (not frames.empty()) {
+				auto& [u, arc] = frames.back();
+				if (arc == offsets[u + 1]) {
+					frames.pop_back();
+					continue;
+				}
+				const auto v = targets[arc++];
+				if (number[v] == npos) {
+					number[v] = vertex.size();
+					tree_parent.push_back(number[u]);
+					vertex.push_back(v);
+					frames.emplace_back(v, offsets[v]);
+				}
+			}
+			const auto reached = vertex.size();
+			auto semi = std::vector<std::size_t>(reached);
+			auto idom = std::vector<std::size_t>(reached, 0);
+			auto ancestor = std::vector<std::size_t>(reached, npos);
+			auto label = std::vector<std::size_t>(reached);
+			std::iota(semi.begin(), semi.end(), std::size_t{0});
+			std::iota(label.begin(), label.end(), std::size_t{0});
+			// bucket_head/bucket_next form intrusive singly linked lists, avoiding a vector per node.
+			auto bucket_head = std::vector<std::size_t>(reached, npos);
+			auto bucket_next = std::vector<std::size_t>(reached, npos);
+			auto path = std::vector<std::size_t>{};
+			const auto eval = [&](std::size_t v) -> std::size_t {
+				if (ancestor[v] == npos) {
+					return v;
+				}
+				for (auto x = v; ancestor[ancestor[x]] != npos; x = ancestor[x]) {
+					path.push_back(x);
+				}
+				while (not path.empty()) {
+					const auto x = path.back();
+					path.pop_back();
+					const auto a = ancestor[x];
+					if (semi[label[a]] < semi[label[x]]) {
+						label[x] = label[a];
+					}
+					ancestor[x] = ancestor[a];
+				}
+				return label[v];
+			};
+			for (auto w = reached - 1; w > 0; --w) {
+				const auto u = vertex[w];
+				for (auto arc = reverse_offsets[u]; arc < reverse_offsets[u + 1]; ++arc) {
+					const auto v = number[reverse_targets[arc]];
+					if (v != npos) {
+						semi[w] = std::min(semi[w], semi[eval(v)]);
+					}
+				}
+				bucket_next[w] = bucket_head[semi[w]];
+				bucket_head[semi[w]] = w;
+				const auto p = tree_parent[w];
+				ancestor[w] = p;
+				for (auto v = bucket_head[p]; v != npos; v = bucket_next[v]) {
+					const auto x = eval(v);
+					idom[v] = semi[x] < semi[v] ? x : p;
+				}
+				bucket_head[p] = npos;
+			}
+			for (auto w = std::size_t{1}; w < reached; ++w) {
+				if (idom[w] != semi[w]) {
+					idom[w] = idom[idom[w]];
+				}
+			}
+			parent_.assign(n, npos);
+			for (auto w = std::size_t{0}; w < reached; ++w) {
+				parent_[vertex[w]] = vertex[idom[w]];
+			}
+		}
+		// Preorder and postorder clocks over the dominator tree, so dominance is interval containment.
+		auto label_intervals(std::size_t start) -> void {
+			const auto n = nodes_.size();
+			auto child_offsets = std::vector<std::size_t>(n + 1, 0);
+			for (auto v = std::size_t{0}; v < n; ++v) {
+				if (v != start and parent_[v] != npos) {
+					++child_offsets[parent_[v] + 1];
+				}
+			}
+			std::partial_sum(child_offsets.begin(), child_offsets.end(), child_offsets.begin());
+			auto children = std::vector<std::size_t>(child_offsets[n]);
+			auto fill = std::vector<std::size_t>(child_offsets.begin(), child_offsets.end() - 1);
+			for (auto v = std::size_t{0}; v < n; ++v) {
+				if (v != start and parent_[v] != npos) {
+					children[fill[parent_[v]]++] = v;
+				}
+			}
+			pre_.assign(n, 0);
+			post_.assign(n, 0);
+			auto clock = std::size_t{0};
+			auto frames = std::vector<std::pair<std::size_t, std::size_t>>{{start, child_offsets[start]}};
+			pre_[start] = clock++;
+			while (not frames.empty()) {
+				auto& [u, next] = frames.back();
+				if (next == child_offsets[u + 1]) {
+					post_[u] = clock++;
+					frames.pop_back();
+					continue;
+				}
+				const auto v = children[next++];
+				pre_[v] = clock++;
+				frames.emplace_back(v, child_offsets[v]);
+			}
+		}
+	};
+	struct diameter_options {
+		// Use edge weights as distances instead of counting hops.
+		bool weighted = false;
+		// 0 means one worker per hardware thread.
+		std::size_t threads = 0;
+	};
+	struct eccentricity_options {
+		bool weighted = false;
+		// Rounds of bound-tightening sweeps after the first sweep in every component.
+		std::size_t rounds = 8;
+		// 0 means one worker per hardware thread. Each round runs one sweep per worker.
+		std::size_t threads = 0;
+	};
+	namespace detail {
+		// Single-source distances from s, leaving reached in non-decreasing distance order so reached.back() is
+		// the farthest node.
+		template<typename N>
+		auto sweep(const csr<N>& g,
+		           shortest_path_workspace& ws,
+		           std::size_t s,
+		           bool weighted,
+		           std::vector<std::size_t>& reached) -> void {
+			ws.reset();
+			reached.clear();
+			ws.stamp[s] = ws.epoch;
+			ws.dist[s] = 0.0;
+			ws.parent[s] = s;
+			if (not weighted) {
+				reached.push_back(s);
+				for (auto head = std::size_t{0}; head < reached.size(); ++head) {
+					const auto v = reached[head];
+					for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+						const auto w = g.targets[arc];
+						if (not ws.reached(w)) {
+							ws.stamp[w] = ws.epoch;
+							ws.dist[w] = ws.dist[v] + 1.0;
+							ws.parent[w] = v;
+							reached.push_back(w);
+						}
+					}
+				}
+				return;
+			}
+			using entry = std::pair<double, std::size_t>;
+			auto heap = std::priority_queue<entry, std::vector<entry>, std::greater<>>{};
+			heap.emplace(0.0, s);
+			while (not heap.empty()) {
+				const auto [d, v] = heap.top();
+				heap.pop();
+				if (d > ws.dist[v]) {
+					continue;
+				}
+				reached.push_back(v);
+				for (auto arc = g.offsets[v]; arc < g.offsets[v + 1]; ++arc) {
+					const auto w = g.targets[arc];
+					const auto alt = d + g.costs[arc];
+					if (not ws.reached(w) or alt < ws.dist[w]) {
+						ws.stamp[w] = ws.epoch;
+						ws.dist[w] = alt;
+						ws.parent[w] = v;
+						heap.emplace(alt, w);
+					}
+				}
+			}
+		}
+		// The node halfway along the shortest-path tree branch from the last sweep's source to t.
+		inline auto midpoint(const shortest_path_workspace& ws, std::size_t t) -> std::size_t {
+			const auto half = ws.dist[t] / 2.0;
+			auto v = t;
+			while (ws.dist[v] > half) {
+				v = ws.parent[v];
+			}
+			return v;
+		}
+		template<typename N, typename E>
+		auto distance_graph(const graph<N, E>& g, bool weighted, const char* caller) -> csr<N> {
+			if (weighted and not std::is_arithmetic_v<E>) {
+				throw std::runtime_error(std::string("Cannot call gdwg::") + caller
+				                         + " with weighted set if E is not arithmetic");
+			}
+			auto res = undirected(make_csr(g, min_cost), min_cost);
+			if (weighted and std::any_of(res.costs.begin(), res.costs.end(), [](double cost) { return cost < 0.0; }))
+			{
+				throw std::runtime_error(std::string("Cannot call gdwg::") + caller
+				                         + " on a graph with negative edge weights");
+			}
+			return res;
+		}
+	} // namespace detail
+	// The largest shortest-path distance between two connected nodes, treating edges as undirected. Each
+	// component is solved with iFUB: a 4-sweep picks a central node u, then fringe nodes are visited from the
+	// farthest level of u inwards until the best eccentricity found is at least twice the current level.
+	template<typename N, typename E>
+	auto diameter(const graph<N, E>& g, const diameter_options& options = {}) -> double {
+		const auto csr = detail::distance_graph(g, options.weighted, "diameter");
+		const auto n = csr.size();
+		const auto workers = detail::worker_count(options.threads, n);
+		auto workspaces = std::vector<detail::shortest_path_workspace>(workers, detail::shortest_path_workspace{n});
+		auto reached = std::vector<std::vector<std::size_t>>(workers);
+		auto& ws = workspaces.front();
+		auto& order = reached.front();
+		auto done = std::vector<bool>(n, false);
+		auto best = 0.0;
+		for (auto root = std::size_t{0}; root < n; ++root) {
+			if (done[root]) {
+				continue;
+			}
+			detail::sweep(csr, ws, root, options.weighted, order);
+			for (const auto v : order) {
+				done[v] = true;
+			}
+			if (order.size() == 1) {
+				continue;
+			}
+			const auto degree = [&](std::size_t v) { return csr.offsets[v + 1] - csr.offsets[v]; };
+			auto u = *std::max_element(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+				return degree(a) < degree(b);
+			});
+			for (auto round = 0; round < 2; ++round) {
+				detail::sweep(csr, ws, u, options.weighted, order);
+				detail::sweep(csr, ws, order.back(), options.weighted, order);
+				best = std::max(best, ws.dist[order.back()]);
+				u = detail::midpoint(ws, order.back());
+			}
+			detail::sweep(csr, ws, u, options.weighted, order);
+			best = std::max(best, ws.dist[order.back()]);
+			auto fringe = std::vector<std::pair<double, std::size_t>>{};
+			fringe.reserve(order.size());
+			for (auto i = order.size(); i-- > 1;) {
+				fringe.emplace_back(ws.dist[order[i]], order[i]);
+			}
+			auto eccentricity = std::vector<double>(workers, 0.0);
+			for (auto i = std::size_t{0}; i < fringe.size() and best < 2.0 * fringe[i].first; i += workers) {
+				const auto batch = std::min(workers, fringe.size() - i);
+				detail::parallel_for(batch, workers, [&](std::size_t, std::size_t j) {
+					detail::sweep(csr, workspaces[j], fringe[i + j].second, options.weighted, reached[j]);
+					eccentricity[j] = workspaces[j].dist[reached[j].back()];
+				});
+				const auto last = eccentricity.begin() + static_cast<std::ptrdiff_t>(batch);
+				best = std::max(best, *std::max_element(eccentricity.begin(), last));
+			}
+		}
+		return best;
+	}
+	// Lower bounds on every node's eccentricity within its component, treating edges as undirected. A sweep
+	// from s gives max(d(s, v), ecc(s) - d(s, v)) <= ecc(v) <= d(s, v) + ecc(s); each round sweeps from the
+	// unresolved nodes with the widest bounds, and nodes whose bounds meet are exact.
+	template<typename N, typename E>
+	auto eccentricities(const graph<N, E>& g, const eccentricity_options& options = {}) -> std::map<N, double> {
+		const auto csr = detail::distance_graph(g, options.weighted, "eccentricities");
+		const auto n = csr.size();
+		const auto infinity = std::numeric_limits<double>::infinity();
+		auto lower = std::vector<double>(n, 0.0);
+		auto upper = std::vector<double>(n, infinity);
+		auto component = std::vector<std::size_t>(n, n);
+		auto roots = std::vector<std::size_t>{};
+		auto queue = std::vector<std::size_t>{};
+		for (auto root = std::size_t{0}; root < n; ++root) {
+			if (component[root] != n) {
+				continue;
+			}
+			// The highest-degree node of each component seeds its first sweep.
+			auto seed = root;
+			component[root] = roots.size();
+			queue.assign(1, root);
+			for (auto head = std::size_t{0}; head < queue.size(); ++head) {
+				const auto v = queue[head];
+				if (csr.offsets[v + 1] - csr.offsets[v] > csr.offsets[seed + 1] - csr.offsets[seed]) {
+					seed = v;
+				}
+				for (auto arc = csr.offsets[v]; arc < csr.offsets[v + 1]; ++arc) {
+					if (component[csr.targets[arc]] == n) {
+						component[csr.targets[arc]] = roots.size();
+						queue.push_back(csr.targets[arc]);
+					}
+				}
+			}
+			roots.push_back(seed);
+		}
+		const auto workers = detail::worker_count(options.threads, n);
+		auto workspaces = std::vector<detail::shortest_path_workspace>(workers, detail::shortest_path_workspace{n});
+		auto reached = std::vector<std::vector<std::size_t>>(workers);
+		const auto tighten = [&](detail::shortest_path_workspace& ws, const std::vector<std::size_t>& order) {
+			const auto eccentricity = ws.dist[order.back()];
+			for (const auto v : order) {
+				lower[v] = std::max({lower[v], ws.dist[v], eccentricity - ws.dist[v]});
+				upper[v] = std::min(upper[v], ws.dist[v] + eccentricity);
+			}
+		};
+		// Components are disjoint, so the seed sweeps never touch the same bounds.
+		detail::parallel_for(roots.size(), workers, [&](std::size_t worker, std::size_t i) {
+			detail::sweep(csr, workspaces[worker], roots[i], options.weighted, reached[worker]);
+			tighten(workspaces[worker], reached[worker]);
+		});
+		auto sources = std::vector<std::size_t>{};
+		auto picked = std::vector<bool>(n, false);
+		for (auto round = std::size_t{0}; round < options.rounds; ++round) {
+			sources.clear();
+			// Alternates between the largest upper bound and the smallest lower bound, as in BoundingDiameters.
+			for (auto i = std::size_t{0}; i < workers; ++i) {
+				auto pick = n;
+				for (auto v = std::size_t{0}; v < n; ++v) {
+					if (picked[v] or lower[v] == upper[v]) {
+						continue;
+					}
+					if (pick == n or (i % 2 == 0 ? upper[v] > upper[pick] : lower[v] < lower[pick])) {
+						pick = v;
+					}
+				}
+				if (pick == n) {
+					break;
+				}
+				picked[pick] = true;
+				sources.push_back(pick);
+			}
+			if (sources.empty()) {
+				break;
+			}
+			detail::parallel_for(sources.size(), workers, [&](std::size_t, std::size_t i) {
+				detail::sweep(csr, workspaces[i], sources[i], options.weighted, reached[i]);
+			});
+			for (auto i = std::size_t{0}; i < sources.size(); ++i) {
+				tighten(workspaces[i], reached[i]);
+			}
+		}
+		return detail::to_node_map(csr.nodes, std::move(lower));
+	}
+	struct personalised_pagerank_options {
+		// Probability of teleporting back to the seeds at each step.
+		double alpha = 0.15;
+		// A node is pushed while its residual is at least epsilon times its out-degree, so every score is within
+		// epsilon * degree of the exact value.
+		double epsilon = 1e-6;
+		// Split a node's mass across its out-edges in proportion to their weights instead of evenly.
+		bool weighted = false;
+	};
+	// Personalised PageRank from a uniform distribution over seeds, computed with the Andersen-Chung-Lang
+	// forward push. Only nodes whose residual crosses the threshold are ever visited, so the work depends on
+	// alpha and epsilon rather than on the size of the graph. Mass reaching a node without out-edges teleports
+	// back to the seeds. Nodes with a zero estimate are omitted.
+	template<typename N, typename E>
+	auto personalised_pagerank(const graph<N, E>& g,
+	                           const std::vector<N>& seeds,
+	                           const personalised_pagerank_options& options = {}) -> std::map<N, double> {
+		if (options.weighted and not std::is_arithmetic_v<E>) {
+			throw std::runtime_error("Cannot call gdwg::personalised_pagerank with weighted set if E is not "
+			                         "arithmetic");
+		}
+		if (not(options.alpha > 0.0 and options.alpha <= 1.0) or not(options.epsilon > 0.0)) {
+			throw std::runtime_error("Cannot call gdwg::personalised_pagerank with alpha outside (0, 1] or a "
+			                         "non-positive epsilon");
+		}
+		const auto& nodes = detail::graph_access::nodes(g);
+		const auto& edges = detail::graph_access::edges(g);
+		auto sources = std::vector<const N*>{};
+		sources.reserve(seeds.size());
+		for (const auto& seed : seeds) {
+			const auto it = nodes.find(seed);
+			if (it == nodes.end()) {
+				throw std::runtime_error("Cannot call gdwg::personalised_pagerank if a seed node doesn't exist in "
+				                         "the graph");
+			}
+			sources.push_back(it->get());
+		}
+		if (sources.empty()) {
+			return {};
+		}
+		struct state {
+			double estimate = 0.0;
+			double residual = 0.0;
+			bool queued = false;
+		};
+		auto touched = std::unordered_map<const N*, state>{};
+		auto queue = std::deque<const N*>{};
+		// Out-edges and their total cost are looked up once per push; nothing is precomputed for the whole graph.
+		const auto out_edges = [&](const N* node) -> const auto* {
+			const auto it = edges.find(*node);
+			return it == edges.end() or it->second.empty() ? nullptr : &it->second;
+		};
+		const auto total_cost = [&](const auto& row) {
+			auto total = 0.0;
+			for (const auto& [dst, weight] : row) {
+				const auto cost = options.weighted ? detail::edge_cost(weight) : 1.0;
+				if (cost < 0.0) {
+					throw std::runtime_error("Cannot call gdwg::personalised_pagerank on a graph with negative edge "
+					                         "weights");
+				}
+				total += cost;
+			}
+			return total;
+		};
+		const auto degree = [&](const N* node) {
+			const auto* row = out_edges(node);
+			return row == nullptr ? 1.0 : static_cast<double>(row->size());
+		};
+		const auto add = [&](const N* node, double mass) {
+			auto& entry = touched[node];
+			entry.residual += mass;
+			if (not entry.queued and entry.residual >= options.epsilon * degree(node)) {
+				entry.queued = true;
+				queue.push_back(node);
+			}
+		};
+		const auto share = 1.0 / static_cast<double>(sources.size());
+		for (const auto* source : sources) {
+			add(source, share);
+		}
+		while (not queue.empty()) {
+			const auto* node = queue.front();
+			queue.pop_front();
+			auto& entry = touched[node];
+			entry.queued = false;
+			const auto mass = std::exchange(entry.residual, 0.0);
+			entry.estimate += options.alpha * mass;
+			const auto spread = (1.0 - options.alpha) * mass;
+			const auto* row = out_edges(node);
+			if (row == nullptr) {
+				for (const auto* source : sources) {
+					add(source, spread * share);
+				}
+				continue;
+			}
+			const auto total = total_cost(*row);
+			for (const auto& [dst, weight] : *row) {
+				const auto cost = options.weighted ? detail::edge_cost(weight) : 1.0;
+				add(dst.get(), total > 0.0 ? spread * cost / total : spread / static_cast<double>(row->size()));
+			}
+		}
+		auto res = std::map<N, double>{};
+		for (const auto& [node, entry] : touched) {
+			if (entry.estimate > 0.0) {
+				res.emplace(*node, entry.estimate);
+			}
+		}
+		return res;
+	}
+	template<typename N, typename E>
+	auto personalised_pagerank(const graph<N, E>& g, const N& seed, const personalised_pagerank_options& options = {})
+	    -> std::map<N, double> {
+		return personalised_pagerank(g, std::vector<N>{seed}, options);
+	}
+	// Answers "is there a directed path from src to dst" for every query; a node always reaches itself. Queries
+	// are grouped by source and each distinct source runs one BFS that stops once all of its targets are found.
+	// Sources are spread over up to `threads` workers (0 means one per hardware thread).
+	template<typename N, typename E>
+	auto reaches_batch(const graph<N, E>& g,
+	                   std::type_identity_t<std::span<const std::pair<N, N>>> queries,
+	                   std::size_t threads = 0) -> std::vector<bool> {
+		const auto csr = detail::make_csr(g, detail::min_cost);
+		const auto n = csr.size();
+		auto resolved = std::vector<std::pair<std::size_t, std::size_t>>{};
+		resolved.reserve(queries.size());
+		for (const auto& [src, dst] : queries) {
+			const auto src_index = csr.index_of(src);
+			const auto dst_index = csr.index_of(dst);
+			if (not src_index or not dst_index) {
+				throw std::runtime_error("Cannot call gdwg::reaches_batch if src or dst node don't exist in the graph");
+			}
+			resolved.emplace_back(*src_index, *dst_index);
+		}
+		auto order = std::vector<std::size_t>(queries.size());
+		std::iota(order.begin(), order.end(), std::size_t{0});
+		std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+			return resolved[lhs] < resolved[rhs];
+		});
+		auto groups = std::vector<std::size_t>{};
+		for (auto i = std::size_t{0}; i < order.size(); ++i) {
+			if (i == 0 or resolved[order[i - 1]].first != resolved[order[i]].first) {
+				groups.push_back(i);
+			}
+		}
+		groups.push_back(order.size());
+		const auto workers = detail::worker_count(threads, groups.size() - 1);
+		// Per-worker visit and target stamps, so no worker clears an n-sized array between sources.
+		auto stamps = std::vector<std::vector<std::size_t>>(workers, std::vector<std::size_t>(n, 0));
+		auto wanted = std::vector<std::vector<std::size_t>>(workers, std::vector<std::size_t>(n, 0));
+		auto epochs = std::vector<std::size_t>(workers, 0);
+		auto queues = std::vector<std::vector<std::size_t>>(workers);
+		auto answers = std::vector<std::uint8_t>(queries.size(), 0);
+		detail::parallel_for(groups.size() - 1, workers, [&](std::size_t worker, std::size_t group) {
+			auto& stamp = stamps[worker];
+			auto& want = wanted[worker];
+			auto& queue = queues[worker];
+			const auto epoch = ++epochs[worker];
+			auto remaining = std::size_t{0};
+			for (auto i = groups[group]; i < groups[group + 1]; ++i) {
+				const auto t = resolved[order[i]].second;
+				if (want[t] != epoch) {
+					want[t] = epoch;
+					++remaining;
+				}
+			}
+			const auto visit = [&](std::size_t v) {
+				stamp[v] = epoch;
+				queue.push_back(v);
+				if (want[v] == epoch) {
+					--remaining;
+				}
+			};
+			queue.clear();
+			visit(resolved[order[groups[group]]].first);
+			for (auto head = std::size_t{0}; head < queue.size() and remaining > 0; ++head) {
+				const auto v = queue[head];
+				for (auto arc = csr.offsets[v]; arc < csr.offsets[v + 1]; ++arc) {
+					if (stamp[csr.targets[arc]] != epoch) {
+						visit(csr.targets[arc]);
+					}
+				}
+			}
+			for (auto i = groups[group]; i < groups[group + 1]; ++i) {
+				answers[order[i]] = stamp[resolved[order[i]].second] == epoch;
+			}
+		});
+		return std::vector<bool>(answers.begin(), answers.end());
+	}
+	namespace detail {
+		// Edges held by value rather than by node pointer, for the graph wrappers that cannot share graph's node
+		// pointers between partitions or versions. Same order as graph's pair_less, by destination then weight,
+		// and searchable by destination alone.
+		template<typename N, typename E>
+		struct value_edge_less {
+			using is_transparent = void;
+			auto operator()(const std::pair<N, std::optional<E>>& lhs, const std::pair<N, std::optional<E>>& rhs) const
+			    -> bool {
+				return lhs < rhs;
+			}
+			auto operator()(const std::pair<N, std::optional<E>>& lhs, const N& rhs) const -> bool {
+				return lhs.first < rhs;
+			}
+			auto operator()(const N& lhs, const std::pair<N, std::optional<E>>& rhs) const -> bool {
+				return lhs < rhs.first;
+			}
+		};
+		template<typename N, typename E>
+		using value_edge_set = std::set<std::pair<N, std::optional<E>>, value_edge_less<N, E>>;
+		// Points every edge to old_data at new_data instead; duplicates collapse.
+		template<typename N, typename E>
+		auto retarget(value_edge_set<N, E>& out, const N& old_data, const N& new_data) -> void {
+			const auto [first, last] = out.equal_range(old_data);
+			auto weights = std::vector<std::optional<E>>{};
+			for (auto it = first; it != last; ++it) {
+				weights.push_back(it->second);
+			}
+			out.erase(first, last);
+			for (auto& weight : weights) {
+				out.emplace(new_data, std::move(weight));
+			}
+		}
+		template<typename N, typename E>
+		auto edges_between(const N& src, const N& dst, const value_edge_set<N, E>& out)
+		    -> std::vector<std::unique_ptr<edge<N, E>>> {
+			auto res = std::vector<std::unique_ptr<edge<N, E>>>{};
+			const auto [first, last] = out.equal_range(dst);
+			for (auto it = first; it != last; ++it) {
+				if (it->second.has_value()) {
+					res.emplace_back(std::make_unique<weighted_edge<N, E>>(src, dst, *it->second));
+				}
+				else {
+					res.emplace_back(std::make_unique<unweighted_edge<N, E>>(src, dst));
+				}
+			}
+			return res;
+		}
+		template<typename N, typename E>
+		auto destinations(const value_edge_set<N, E>& out) -> std::vector<N> {
+			auto res = std::vector<N>{};
+			for (const auto& [dst, weight] : out) {
+				if (res.empty() or res.back() != dst) {
+					res.push_back(dst);
+				}
+			}
+			return res;
+		}
+	} // namespace detail
+	// A thread-safe graph whose nodes are sharded by std::hash<N> into independently locked partitions. A node's
+	// shard owns its outgoing edges, so insert_edge and erase_edge lock only the source's shard exclusively (and
+	// the destination's shared, to check it exists) while readers take shared locks. Operations that must see
+	// every incoming edge (erase_node, replace_node, merge_replace_node, clear) lock all shards. Shards are
+	// always locked in index order, so no two operations can deadlock. Iterators are not offered because they
+	// could not stay valid under concurrent modification; to_graph() takes a consistent copy instead.
+	template<typename N, typename E>
+	class concurrent_graph {
+	 public:
+		// 0 means four shards per hardware thread.
+		explicit concurrent_graph(std::size_t shards = 0)
+		: shards_(shards != 0 ? shards : 4 * detail::worker_count(0, std::numeric_limits<std::size_t>::max())) {}
+		concurrent_graph(std::initializer_list<N> il)
+		: concurrent_graph() {
+			for (const auto& value : il) {
+				insert_node(value);
+			}
+		}
+		explicit concurrent_graph(const graph<N, E>& g, std::size_t shards = 0)
+		: concurrent_graph(shards) {
+			for (const auto& node : detail::graph_access::nodes(g)) {
+				shard_of(*node).out.emplace(*node, edge_set{});
+			}
+			for (const auto& [src, dst_set] : detail::graph_access::edges(g)) {
+				auto& out = shard_of(*src).out.at(*src);
+				for (const auto& [dst, weight] : dst_set) {
+					out.emplace_hint(out.end(), *dst, weight);
+				}
+			}
+		}
+		concurrent_graph(const concurrent_graph&) = delete;
+		auto operator=(const concurrent_graph&) -> concurrent_graph& = delete;
+
+		auto clear() -> void {
+			const auto locks = lock_all<std::unique_lock<std::shared_mutex>>();
+			for (auto& shard : shards_) {
+				shard.out.clear();
+			}
+		}
+		auto insert_node(const N& value) -> bool {
+			auto& shard = shard_of(value);
+			const auto lock = std::unique_lock{shard.mutex};
+			return shard.out.emplace(value, edge_set{}).second;
+		}
+		auto insert_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> bool {
+			const auto locks = lock_pair(src, dst, true);
+			const auto src_it = shard_of(src).out.find(src);
+			if (src_it == shard_of(src).out.end() or not shard_of(dst).out.contains(dst)) {
+				throw std::runtime_error("Cannot call gdwg::concurrent_graph<N, E>::insert_edge when either src or dst "
+				                         "node does not exist");
+			}
+			return src_it->second.emplace(dst, weight).second;
+		}
+		[[nodiscard]] auto is_node(const N& value) const -> bool {
+			const auto& shard = shard_of(value);
+			const auto lock = std::shared_lock{shard.mutex};
+			return shard.out.contains(value);
+		}
+		[[nodiscard]] auto empty() const -> bool {
+			const auto locks = lock_all<std::shared_lock<std::shared_mutex>>();
+			return std::all_of(shards_.begin(), shards_.end(), [](const shard& s) { return s.out.empty(); });
+		}
+		[[nodiscard]] auto nodes() const -> std::vector<N> {
+			auto res = std::vector<N>{};
+			{
+				const auto locks = lock_all<std::shared_lock<std::shared_mutex>>();
+				for (const auto& shard : shards_) {
+					for (const auto& [node, out] : shard.out) {
+						res.push_back(node);
+					}
+				}
+			}
+			std::sort(res.begin(), res.end());
+			return res;
+		}
+		[[nodiscard]] auto is_connected(const N& src, const N& dst) const -> bool {
+			const auto locks = lock_pair(src, dst, false);
+			const auto src_it = shard_of(src).out.find(src);
+			if (src_it == shard_of(src).out.end() or not shard_of(dst).out.contains(dst)) {
+				throw std::runtime_error("Cannot call gdwg::concurrent_graph<N, E>::is_connected if src or dst node "
+				                         "don't exist in the graph");
+			}
+			return src_it->second.contains(dst);
+		}
+		[[nodiscard]] auto edges(const N& src, const N& dst) const -> std::vector<std::unique_ptr<edge<N, E>>> {
+			const auto locks = lock_pair(src, dst, false);
+			const auto src_it = shard_of(src).out.find(src);
+			if (src_it == shard_of(src).out.end() or not shard_of(dst).out.contains(dst)) {
+				throw std::runtime_error("Cannot call gdwg::concurrent_graph<N, E>::edges if src or dst node don't "
+				                         "exist in the graph");
+			}
+			return detail::edges_between(src, dst, src_it->second);
+		}
+		[[nodiscard]] auto connections(const N& src) const -> std::vector<N> {
+			const auto& shard = shard_of(src);
+			const auto lock = std::shared_lock{shard.mutex};
+			const auto src_it = shard.out.find(src);
+			if (src_it == shard.out.end()) {
+				throw std::runtime_error("Cannot call gdwg::concurrent_graph<N, E>::connections if src doesn't exist "
+				                         "in the graph");
+			}
+			return detail::destinations(src_it->second);
+		}
+		auto erase_node(const N& value) -> bool {
+			const auto locks = lock_all<std::unique_lock<std::shared_mutex>>();
+			if (shard_of(value).out.erase(value) == 0) {
+				return false;
+			}
+			for_each_edge_set([&](edge_set& out) {
+				const auto [first, last] = out.equal_range(value);
+				out.erase(first, last);
+			});
+			return true;
+		}
+		auto erase_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> bool {
+			const auto locks = lock_pair(src, dst, true);
+			const auto src_it = shard_of(src).out.find(src);
+			if (src_it == shard_of(src).out.end() or not shard_of(dst).out.contains(dst)) {
+				throw std::runtime_error("Cannot call gdwg::concurrent_graph<N, E>::erase_edge on src or dst if they "
+				                         "don't exist in the graph");
+			}
+			return src_it->second.erase({dst, weight}) != 0;
+		}
+		auto replace_node(const N& old_data, const N& new_data) -> bool {
+			const auto locks = lock_all<std::unique_lock<std::shared_mutex>>();
+			if (not shard_of(old_data).out.contains(old_data)) {
+				throw std::runtime_error("Cannot call gdwg::concurrent_graph<N, E>::replace_node on a node that "
+				                         "doesn't exist");
+			}
+			if (shard_of(new_data).out.contains(new_data)) {
+				return false;
+			}
+			shard_of(new_data).out.emplace(new_data, edge_set{});
+			redirect(old_data, new_data);
+			return true;
+		}
+		auto merge_replace_node(const N& old_data, const N& new_data) -> void {
+			const auto locks = lock_all<std::unique_lock<std::shared_mutex>>();
+			if (not shard_of(old_data).out.contains(old_data) or not shard_of(new_data).out.contains(new_data)) {
+				throw std::runtime_error("Cannot call gdwg::concurrent_graph<N, E>::merge_replace_node on old or new "
+				                         "data if they don't exist in the graph");
+			}
+			if (old_data != new_data) {
+				redirect(old_data, new_data);
+			}
+		}
+		// A consistent copy of the whole graph, taken under shared locks on every shard.
+		[[nodiscard]] auto to_graph() const -> graph<N, E> {
+			auto res = graph<N, E>{};
+			const auto locks = lock_all<std::shared_lock<std::shared_mutex>>();
+			for (const auto& shard : shards_) {
+				for (const auto& [node, out] : shard.out) {
+					res.insert_node(node);
+				}
+			}
+			for (const auto& shard : shards_) {
+				for (const auto& [node, out] : shard.out) {
+					for (const auto& [dst, weight] : out) {
+						res.insert_edge(node, dst, weight);
+					}
+				}
+			}
+			return res;
+		}
+		friend auto operator<<(std::ostream& os, const concurrent_graph& g) -> std::ostream& {
+			return os << g.to_graph();
+		}
+
+	 private:
+		using edge_set = detail::value_edge_set<N, E>;
+		struct shard {
+			mutable std::shared_mutex mutex;
+			std::map<N, edge_set> out;
+		};
+		std::vector<shard> shards_;
+
+		[[nodiscard]] auto index_of(const N& value) const -> std::size_t {
+			return std::hash<N>{}(value) % shards_.size();
+		}
+		[[nodiscard]] auto shard_of(const N& value) -> shard& {
+			return shards_[index_of(value)];
+		}
+		[[nodiscard]] auto shard_of(const N& value) const -> const shard& {
+			return shards_[index_of(value)];
+		}
+		template<typename Lock>
+		[[nodiscard]] auto lock_all() const -> std::vector<Lock> {
+			auto res = std::vector<Lock>{};
+			res.reserve(shards_.size());
+			for (const auto& shard : shards_) {
+				res.emplace_back(shard.mutex);
+			}
+			return res;
+		}
+		struct pair_lock {
+			std::unique_lock<std::shared_mutex> exclusive;
+			std::shared_lock<std::shared_mutex> first;
+			std::shared_lock<std::shared_mutex> second;
+		};
+		// Locks the source's shard (exclusively if asked) and the destination's shard shared, in index order.
+		[[nodiscard]] auto lock_pair(const N& src, const N& dst, bool exclusive) const -> pair_lock {
+			const auto i = index_of(src);
+			const auto j = index_of(dst);
+			auto res = pair_lock{};
+			const auto lock = [&](std::size_t k, std::shared_lock<std::shared_mutex>& slot) {
+				if (k == i and exclusive) {
+					res.exclusive = std::unique_lock{shards_[k].mutex};
+				}
+				else {
+					slot = std::shared_lock{shards_[k].mutex};
+				}
+			};
+			lock(std::min(i, j), res.first);
+			if (i != j) {
+				lock(std::max(i, j), res.second);
+			}
+			return res;
+		}
+		template<typename F>
+		auto for_each_edge_set(F fn) -> void {
+			for (auto& shard : shards_) {
+				for (auto& [node, out] : shard.out) {
+					fn(out);
+				}
+			}
+		}
+		// Moves old_data's outgoing and incoming edges onto new_data, which must already exist, and erases
+		// old_data. Duplicates collapse because the edge sets are sets. Callers hold every shard's lock.
+		auto redirect(const N& old_data, const N& new_data) -> void {
+			auto& old_shard = shard_of(old_data).out;
+			auto moved = std::move(old_shard.at(old_data));
+			old_shard.erase(old_data);
+			shard_of(new_data).out.at(new_data).merge(moved);
+			for_each_edge_set([&](edge_set& out) { detail::retarget(out, old_data, new_data); });
+		}
+	};
+	namespace detail {
+		// Epoch-based reclamation. A reader publishes the global epoch it started in for as long as it holds
+		// pointers into shared structures. Memory retired in epoch r can be freed once no active reader started in
+		// r or earlier, so readers never touch a reference count.
+		class epoch_domain {
+		 public:
+			static constexpr auto idle = std::numeric_limits<std::uint64_t>::max();
+			auto acquire_slot() -> std::atomic<std::uint64_t>* {
+				const auto lock = std::lock_guard{mutex_};
+				for (auto& slot : slots_) {
+					if (not slot.used) {
+						slot.used = true;
+						return &slot.epoch;
+					}
+				}
+				auto& slot = slots_.emplace_back();
+				slot.used = true;
+				return &slot.epoch;
+			}
+			auto release_slot(std::atomic<std::uint64_t>* epoch) -> void {
+				const auto lock = std::lock_guard{mutex_};
+				for (auto& slot : slots_) {
+					if (&slot.epoch == epoch) {
+						slot.used = false;
+					}
+				}
+			}
+			// Readers load shared pointers with seq_cst, so the published epoch is ordered before them, and a
+			// reclaimer that misses it in advance() is ordered before them too. A seq_cst load costs the same as
+			// an acquire load on common hardware.
+			auto pin(std::atomic<std::uint64_t>& slot) const -> void {
+				slot.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+			}
+			static auto unpin(std::atomic<std::uint64_t>& slot) -> void {
+				slot.store(idle, std::memory_order_release);
+			}
+			// Pins a slot from a small shared table, for readers that hold pointers only for a few instructions
+			// and so are not worth registering. Claiming one is a compare-and-swap and never takes the mutex; a
+			// reader retries only while every slot is held by another such reader. Release it with unpin().
+			auto pin_transient() const -> std::atomic<std::uint64_t>& {
+				const auto start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+				for (auto i = start;; ++i) {
+					auto& slot = transient_[i % transient_.size()].epoch;
+					auto expected = idle;
+					if (slot.load(std::memory_order_relaxed) == idle
+					    and slot.compare_exchange_strong(expected, epoch_.load(std::memory_order_seq_cst),
+					                                     std::memory_order_seq_cst))
+					{
+						return slot;
+					}
+				}
+			}
+			// The epoch to stamp on memory that has just been unlinked.
+			[[nodiscard]] auto now() const -> std::uint64_t {
+				return epoch_.load(std::memory_order_seq_cst);
+			}
+			// Starts a new epoch and returns the oldest epoch an active reader may have started in. Memory retired
+			// in an earlier epoch is unreachable to every reader.
+			auto advance() -> std::uint64_t {
+				auto res = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+				const auto lock = std::lock_guard{mutex_};
+				for (const auto& slot : slots_) {
+					res = std::min(res, slot.epoch.load(std::memory_order_seq_cst));
+				}
+				for (const auto& slot : transient_) {
+					res = std::min(res, slot.epoch.load(std::memory_order_seq_cst));
+				}
+				return res;
+			}
+
+		 private:
+			// Each slot is written by one reader, so slots get their own cache lines.
+			struct alignas(64) slot {
+				std::atomic<std::uint64_t> epoch{idle};
+				bool used = false;
+			};
+			std::atomic<std::uint64_t> epoch_{0};
+			mutable std::mutex mutex_;
+			std::deque<slot> slots_;
+			mutable std::array<slot, 16> transient_;
+		};
+	} // namespace detail
+	template<typename N, typename E>
+	class versioned_graph;
+	// An immutable, consistent view of a versioned_graph at one version. Snapshots are cheap to take and copy,
+	// need no locks to read, and keep working however far the writer moves on; a version's memory is released
+	// when the last snapshot holding it is destroyed.
+	template<typename N, typename E>
+	class graph_snapshot {
+	 public:
+		[[nodiscard]] auto version() const noexcept -> std::uint64_t {
+			return state_->number;
+		}
+		[[nodiscard]] auto is_node(const N& value) const -> bool {
+			return bucket_of(value).contains(value);
+		}
+		[[nodiscard]] auto empty() const noexcept -> bool {
+			return state_->node_count == 0;
+		}
+		[[nodiscard]] auto nodes() const -> std::vector<N> {
+			auto res = std::vector<N>{};
+			res.reserve(state_->node_count);
+			for (const auto& bucket : state_->buckets) {
+				for (const auto& [node, out] : *bucket) {
+					res.push_back(node);
+				}
+			}
+			std::sort(res.begin(), res.end());
+			return res;
+		}
+		[[nodiscard]] auto is_connected(const N& src, const N& dst) const -> bool {
+			const auto* out = find(src);
+			if (out == nullptr or not is_node(dst)) {
+				throw std::runtime_error("Cannot call gdwg::graph_snapshot<N, E>::is_connected if src or dst node "
+				                         "don't exist in the graph");
+			}
+			return out->contains(dst);
+		}
+		[[nodiscard]] auto edges(const N& src, const N& dst) const -> std::vector<std::unique_ptr<edge<N, E>>> {
+			const auto* out = find(src);
+			if (out == nullptr or not is_node(dst)) {
+				throw std::runtime_error("Cannot call gdwg::graph_snapshot<N, E>::edges if src or dst node don't "
+				                         "exist in the graph");
+			}
+			return detail::edges_between(src, dst, *out);
+		}
+		[[nodiscard]] auto connections(const N& src) const -> std::vector<N> {
+			const auto* out = find(src);
+			if (out == nullptr) {
+				throw std::runtime_error("Cannot call gdwg::graph_snapshot<N, E>::connections if src doesn't exist "
+				                         "in the graph");
+			}
+			return detail::destinations(*out);
+		}
+		[[nodiscard]] auto to_graph() const -> graph<N, E> {
+			auto res = graph<N, E>{};
+			for (const auto& bucket : state_->buckets) {
+				for (const auto& [node, out] : *bucket) {
+					res.insert_node(node);
+				}
+			}
+			for (const auto& bucket : state_->buckets) {
+				for (const auto& [node, out] : *bucket) {
+					for (const auto& [dst, weight] : *out) {
+						res.insert_edge(node, dst, weight);
+					}
+				}
+			}
+			return res;
+		}
+		friend auto operator<<(std::ostream& os, const graph_snapshot& g) -> std::ostream& {
+			return os << g.to_graph();
+		}
+
+	 private:
+		friend class versioned_graph<N, E>;
+		using edge_set = detail::value_edge_set<N, E>;
+		// Nodes are hashed into a fixed number of buckets. A write copies the bucket pointer array, the buckets
+		// it touches and the edge sets it changes; everything else is shared with the previous version.
+		using bucket = std::map<N, std::shared_ptr<const edge_set>>;
+		struct state {
+			std::uint64_t number = 0;
+			std::size_t node_count = 0;
+			std::vector<std::shared_ptr<const bucket>> buckets;
+		};
+		std::shared_ptr<const state> state_;
+
+		explicit graph_snapshot(std::shared_ptr<const state> current)
+		: state_(std::move(current)) {}
+		[[nodiscard]] auto bucket_of(const N& value) const -> const bucket& {
+			return *state_->buckets[std::hash<N>{}(value) % state_->buckets.size()];
+		}
+		[[nodiscard]] auto find(const N& value) const -> const edge_set* {
+			const auto& b = bucket_of(value);
+			const auto it = b.find(value);
+			return it == b.end() ? nullptr : it->second.get();
+		}
+	};
+	// A graph with multi-version concurrency control. Writers are serialised among themselves and build each
+	// change as a new version off to the side, then publish it by swapping one atomic pointer. snapshot() pins an
+	// epoch, loads that pointer and copies the version's shared_ptr; it takes no lock and never waits for a
+	// writer. A replaced pointer is freed once no reader can still be copying from it.
+	template<typename N, typename E>
+	class versioned_graph {
+	 public:
+		explicit versioned_graph(std::size_t buckets = 256) {
+			auto initial = std::make_shared<state>();
+			initial->buckets.assign(std::max(std::size_t{1}, buckets), std::make_shared<const bucket>());
+			current_.store(std::make_unique<const published>(std::move(initial)).release());
+		}
+		versioned_graph(std::initializer_list<N> il)
+		: versioned_graph() {
+			auto lock = std::lock_guard{writer_};
+			auto next = draft(current());
+			for (const auto& value : il) {
+				next.insert_node(value);
+			}
+			publish(next);
+		}
+		versioned_graph(const versioned_graph&) = delete;
+		auto operator=(const versioned_graph&) -> versioned_graph& = delete;
+		~versioned_graph() {
+			delete current_.load(std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] auto snapshot() const -> graph_snapshot<N, E> {
+			auto& slot = domain_.pin_transient();
+			auto res = graph_snapshot<N, E>(*current_.load(std::memory_order_seq_cst));
+			detail::epoch_domain::unpin(slot);
+			return res;
+		}
+		auto clear() -> void {
+			write([](draft& next) {
+				for (auto& b : next.buckets) {
+					b = std::make_shared<const bucket>();
+				}
+				next.node_count = 0;
+				return true;
+			});
+		}
+		auto insert_node(const N& value) -> bool {
+			return write([&](draft& next) { return next.insert_node(value); });
+		}
+		auto insert_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> bool {
+			return write([&](draft& next) {
+				if (not next.contains(src) or not next.contains(dst)) {
+					throw std::runtime_error("Cannot call gdwg::versioned_graph<N, E>::insert_edge when either src or "
+					                         "dst node does not exist");
+				}
+				if (next.out(src).contains(std::pair{dst, weight})) {
+					return false;
+				}
+				return next.writable_out(src).emplace(dst, std::move(weight)).second;
+			});
+		}
+		auto erase_node(const N& value) -> bool {
+			return write([&](draft& next) {
+				if (not next.contains(value)) {
+					return false;
+				}
+				next.writable_bucket(value).erase(value);
+				--next.node_count;
+				next.for_each_referencing(value, [&](edge_set& out) {
+					const auto [first, last] = out.equal_range(value);
+					out.erase(first, last);
+				});
+				return true;
+			});
+		}
+		auto erase_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> bool {
+			return write([&](draft& next) {
+				if (not next.contains(src) or not next.contains(dst)) {
+					throw std::runtime_error("Cannot call gdwg::versioned_graph<N, E>::erase_edge on src or dst if "
+					                         "they don't exist in the graph");
+				}
+				if (not next.out(src).contains(std::pair{dst, weight})) {
+					return false;
+				}
+				return next.writable_out(src).erase(std::pair{dst, weight}) != 0;
+			});
+		}
+		auto replace_node(const N& old_data, const N& new_data) -> bool {
+			return write([&](draft& next) {
+				if (not next.contains(old_data)) {
+					throw std::runtime_error("Cannot call gdwg::versioned_graph<N, E>::replace_node on a node that "
+					                         "doesn't exist");
+				}
+				if (next.contains(new_data)) {
+					return false;
+				}
+				next.insert_node(new_data);
+				next.redirect(old_data, new_data);
+				return true;
+			});
+		}
+		auto merge_replace_node(const N& old_data, const N& new_data) -> void {
+			write([&](draft& next) {
+				if (not next.contains(old_data) or not next.contains(new_data)) {
+					throw std::runtime_error("Cannot call gdwg::versioned_graph<N, E>::merge_replace_node on old or "
+					                         "new data if they don't exist in the graph");
+				}
+				if (old_data == new_data) {
+					return false;
+				}
+				next.redirect(old_data, new_data);
+				return true;
+			});
+		}
+
+	 private:
+		using edge_set = typename graph_snapshot<N, E>::edge_set;
+		using bucket = typename graph_snapshot<N, E>::bucket;
+		using state = typename graph_snapshot<N, E>::state;
+		// The version being built by the current writer. Buckets and edge sets are copied the first time they are
+		// written, so the published versions they came from are never modified.
+		struct draft {
+			explicit draft(std::shared_ptr<const state> base)
+			: number(base->number + 1)
+			, node_count(base->node_count)
+			, buckets(base->buckets)
+			, copied(buckets.size(), nullptr) {}
+			std::uint64_t number;
+			std::size_t node_count;
+			std::vector<std::shared_ptr<const bucket>> buckets;
+			std::vector<bucket*> copied;
+			// Edge sets this draft has already copied, so a set written twice in one version is copied once.
+			std::unordered_map<const edge_set*, edge_set*> copied_sets;
+
+			[[nodiscard]] auto index_of(const N& value) const -> std::size_t {
+				return std::hash<N>{}(value) % buckets.size();
+			}
+			[[nodiscard]] auto contains(const N& value) const -> bool {
+				return buckets[index_of(value)]->contains(value);
+			}
+			[[nodiscard]] auto out(const N& value) const -> const edge_set& {
+				return *buckets[index_of(value)]->at(value);
+			}
+			auto writable_bucket(std::size_t i) -> bucket& {
+				if (copied[i] == nullptr) {
+					auto copy = std::make_shared<bucket>(*buckets[i]);
+					copied[i] = copy.get();
+					buckets[i] = std::move(copy);
+				}
+				return *copied[i];
+			}
+			auto writable_bucket(const N& value) -> bucket& {
+				return writable_bucket(index_of(value));
+			}
+			auto writable(std::shared_ptr<const edge_set>& slot) -> edge_set& {
+				if (const auto it = copied_sets.find(slot.get()); it != copied_sets.end()) {
+					return *it->second;
+				}
+				auto copy = std::make_shared<edge_set>(*slot);
+				auto* res = copy.get();
+				copied_sets.insert_or_assign(res, res);
+				slot = std::move(copy);
+				return *res;
+			}
+			auto writable_out(const N& value) -> edge_set& {
+				return writable(writable_bucket(value).at(value));
+			}
+			auto insert_node(const N& value) -> bool {
+				if (contains(value)) {
+					return false;
+				}
+				writable_bucket(value).emplace(value, std::make_shared<const edge_set>());
+				++node_count;
+				return true;
+			}
+			// Calls fn on a private copy of every edge set with an edge to value.
+			template<typename F>
+			auto for_each_referencing(const N& value, F fn) -> void {
+				for (auto i = std::size_t{0}; i < buckets.size(); ++i) {
+					const auto& b = *buckets[i];
+					for (auto it = b.begin(); it != b.end(); ++it) {
+						if (it->second->contains(value)) {
+							fn(writable(writable_bucket(i).at(it->first)));
+						}
+					}
+				}
+			}
+			auto redirect(const N& old_data, const N& new_data) -> void {
+				auto& old_bucket = writable_bucket(old_data);
+				auto moved = edge_set(*old_bucket.at(old_data));
+				old_bucket.erase(old_data);
+				--node_count;
+				writable_out(new_data).merge(moved);
+				for_each_referencing(old_data, [&](edge_set& out) { detail::retarget(out, old_data, new_data); });
+			}
+		};
+		// The shared_ptr to the current version lives behind a plain atomic pointer, so readers load it without
+		// a lock and copy it under an epoch pin.
+		using published = std::shared_ptr<const state>;
+		struct retired {
+			std::uint64_t epoch;
+			std::unique_ptr<const published> version;
+		};
+		std::atomic<const published*> current_;
+		detail::epoch_domain domain_;
+		std::mutex writer_;
+		// Replaced pointers that a reader may still be copying from. Only touched by writers.
+		std::vector<retired> retired_;
+
+		// Only called by writers, which are the only ones to replace current_.
+		[[nodiscard]] auto current() const -> published {
+			return *current_.load(std::memory_order_relaxed);
+		}
+		auto publish(draft& next) -> void {
+			auto version = std::make_shared<state>();
+			version->number = next.number;
+			version->node_count = next.node_count;
+			version->buckets = std::move(next.buckets);
+			auto replacement = std::make_unique<const published>(std::move(version));
+			const auto* old = current_.exchange(replacement.release(), std::memory_order_seq_cst);
+			retired_.push_back({domain_.now(), std::unique_ptr<const published>(old)});
+			// The previous version itself is released when the last snapshot holding it goes, possibly right here.
+			const auto safe = domain_.advance();
+			std::erase_if(retired_, [&](const retired& entry) { return entry.epoch < safe; });
+		}
+
+		// Runs fn on a draft of the next version and publishes it if fn reports a change.
+		template<typename F>
+		auto write(F fn) -> bool {
+			const auto lock = std::lock_guard{writer_};
+			auto next = draft(current());
+			if (not fn(next)) {
+				return false;
+			}
+			publish(next);
+			return true;
+		}
+	};
+	// Collects edges from many threads at once for a fixed set of nodes, then turns them into a graph with
+	// seal(). insert_edge never takes a lock: each source node owns a chain of chunks, and a writer claims a slot
+	// in the newest chunk with one fetch_add, installing a larger chunk with a compare-and-swap when it is full.
+	// Duplicates are kept until seal(), which sorts and deduplicates every source's edges into pair_less order.
+	template<typename N, typename E>
+	class edge_ingest {
+	 public:
+		edge_ingest(std::initializer_list<N> il)
+		: edge_ingest(graph<N, E>(il)) {}
+		// The graph's nodes become the node set, and its edges are kept and merged with the ingested ones on seal().
+		explicit edge_ingest(graph<N, E> base)
+		: base_(std::move(base))
+		, heads_(detail::graph_access::nodes(base_).size()) {
+			nodes_.reserve(heads_.size());
+			for (const auto& node : detail::graph_access::nodes(base_)) {
+				nodes_.push_back(*node);
+			}
+		}
+		edge_ingest(const edge_ingest&) = delete;
+		auto operator=(const edge_ingest&) -> edge_ingest& = delete;
+		~edge_ingest() {
+			release();
+		}
+
+		// Safe to call from any number of threads at once, but not concurrently with seal().
+		auto insert_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> void {
+			const auto src_index = index_of(src);
+			const auto dst_index = index_of(dst);
+			if (src_index == nodes_.size() or dst_index == nodes_.size()) {
+				throw std::runtime_error("Cannot call gdwg::edge_ingest<N, E>::insert_edge when either src or dst "
+				                         "node does not exist");
+			}
+			auto& head = heads_[src_index];
+			auto* current = head.load(std::memory_order_acquire);
+			for (;;) {
+				if (current != nullptr) {
+					const auto slot = current->used.fetch_add(1, std::memory_order_relaxed);
+					if (slot < current->items.size()) {
+						current->items[slot] = {dst_index, std::move(weight)};
+						return;
+					}
+				}
+				const auto capacity = current == nullptr ? first_chunk : 2 * current->items.size();
+				auto fresh = std::make_unique<chunk>(capacity, current, dst_index, weight);
+				// On failure current is reloaded with the chunk another writer installed, and the loop retries it.
+				if (head.compare_exchange_strong(current, fresh.get(), std::memory_order_acq_rel)) {
+					static_cast<void>(fresh.release());
+					return;
+				}
+			}
+		}
+		// Builds the graph from the base graph and every ingested edge, sorting and deduplicating each source's
+		// edges on up to `threads` workers (0 means one per hardware thread). Afterwards the ingest holds the same
+		// nodes and no edges. All insert_edge calls must have finished, e.g. by joining their threads.
+		[[nodiscard]] auto seal(std::size_t threads = 0) -> graph<N, E> {
+			using item = std::pair<std::size_t, std::optional<E>>;
+			const auto n = nodes_.size();
+			auto sorted = std::vector<std::vector<item>>(n);
+			detail::parallel_for(n, threads, [&](std::size_t, std::size_t s) {
+				auto& items = sorted[s];
+				for (auto* c = heads_[s].load(std::memory_order_acquire); c != nullptr; c = c->previous) {
+					const auto used = std::min(c->used.load(std::memory_order_relaxed), c->items.size());
+					items.insert(items.end(), c->items.begin(), c->items.begin() + static_cast<std::ptrdiff_t>(used));
+				}
+				std::sort(items.begin(), items.end());
+				items.erase(std::unique(items.begin(), items.end()), items.end());
+			});
+			auto res = std::move(base_);
+			auto pointers = std::vector<std::shared_ptr<N>>(detail::graph_access::nodes(res).begin(),
+			                                                detail::graph_access::nodes(res).end());
+			auto& edges = detail::graph_access::mutable_edges(res);
+			for (auto s = std::size_t{0}; s < n; ++s) {
+				if (sorted[s].empty()) {
+					continue;
+				}
+				auto& out = edges.try_emplace(edges.end(), pointers[s])->second;
+				for (auto& [dst, weight] : sorted[s]) {
+					out.emplace_hint(out.end(), pointers[dst], std::move(weight));
+				}
+			}
+			release();
+			base_ = graph<N, E>(nodes_.begin(), nodes_.end());
+			return res;
+		}
+
+	 private:
+		static constexpr auto first_chunk = std::size_t{16};
+		struct chunk {
+			// Built holding its first item, so the writer that allocates a chunk never writes into it afterwards.
+			chunk(std::size_t capacity, chunk* older, std::size_t dst_index, std::optional<E> weight)
+			: used(1)
+			, previous(older) {
+				items.reserve(capacity);
+				items.emplace_back(dst_index, std::move(weight));
+				items.resize(capacity);
+			}
+			std::vector<std::pair<std::size_t, std::optional<E>>> items;
+			// Slots handed out so far; may run past items.size() when writers race for a full chunk.
+			std::atomic<std::size_t> used = 0;
+			// Older, full chunks. Owned by this chunk once it is installed.
+			chunk* previous;
+		};
+		graph<N, E> base_;
+		std::vector<N> nodes_;
+		std::vector<std::atomic<chunk*>> heads_;
+
+		[[nodiscard]] auto index_of(const N& value) const -> std::size_t {
+			const auto it = std::lower_bound(nodes_.begin(), nodes_.end(), value);
+			return it != nodes_.end() and *it == value ? static_cast<std::size_t>(it - nodes_.begin()) : nodes_.size();
+		}
+		auto release() -> void {
+			for (auto& head : heads_) {
+				for (auto* c = head.exchange(nullptr); c != nullptr;) {
+					delete std::exchange(c, c->previous);
+				}
+			}
+		}
+	};
+	// A graph for read-mostly concurrent traversal. Nodes live in slots that never move, and readers see them
+	// through plain handles rather than shared pointers, so walking the graph costs no atomic read-modify-writes.
+	// Writers are serialised; each change publishes a fresh copy of the edge list or bucket it touches, and the
+	// old copy is freed only once every reader that could still see it has unpinned.
+	template<typename N, typename E>
+	class epoch_graph {
+	 public:
+		// Names a node slot. A handle stays valid for as long as the read_guard it came from.
+		struct node_handle {
+			std::uint32_t index;
+			auto operator==(const node_handle&) const -> bool = default;
+		};
+		struct edge_entry {
+			node_handle to;
+			std::optional<E> weight;
+		};
+		class read_guard;
+		// Registers a reader with the graph. Keep one per reading thread and pin() it around each traversal.
+		class reader {
+		 public:
+			explicit reader(const epoch_graph& g)
+			: graph_(&g)
+			, slot_(g.domain_.acquire_slot()) {}
+			reader(const reader&) = delete;
+			auto operator=(const reader&) -> reader& = delete;
+			~reader() {
+				graph_->domain_.release_slot(slot_);
+			}
+			// Only one guard per reader may be alive at a time.
+			[[nodiscard]] auto pin() -> read_guard {
+				return read_guard(*graph_, *slot_);
+			}
+
+		 private:
+			const epoch_graph* graph_;
+			std::atomic<std::uint64_t>* slot_;
+		};
+		// A pinned view of the graph. Everything it hands out stays readable until it is destroyed.
+		class read_guard {
+		 public:
+			read_guard(const read_guard&) = delete;
+			auto operator=(const read_guard&) -> read_guard& = delete;
+			~read_guard() {
+				detail::epoch_domain::unpin(*slot_);
+			}
+			[[nodiscard]] auto find(const N& value) const -> std::optional<node_handle> {
+				const auto index = graph_->find_index(value);
+				return index ? std::optional<node_handle>{node_handle{*index}} : std::nullopt;
+			}
+			[[nodiscard]] auto is_node(const N& value) const -> bool {
+				return graph_->find_index(value).has_value();
+			}
+			[[nodiscard]] auto value(node_handle node) const -> const N& {
+				return *graph_->slot(node.index).value;
+			}
+			// The outgoing edges of node, ordered by destination value and then weight.
+			[[nodiscard]] auto edges(node_handle node) const -> std::span<const edge_entry> {
+				const auto* out = graph_->slot(node.index).out.load(std::memory_order_seq_cst);
+				return out == nullptr ? std::span<const edge_entry>{} : std::span<const edge_entry>(*out);
+			}
+			// Every node, ordered by value.
+			[[nodiscard]] auto nodes() const -> std::vector<node_handle> {
+				auto res = std::vector<node_handle>{};
+				for (const auto& bucket : graph_->buckets_) {
+					for (const auto index : *bucket.load(std::memory_order_seq_cst)) {
+						res.push_back(node_handle{index});
+					}
+				}
+				std::sort(res.begin(), res.end(), [&](node_handle lhs, node_handle rhs) {
+					return value(lhs) < value(rhs);
+				});
+				return res;
+			}
+
+		 private:
+			friend class reader;
+			const epoch_graph* graph_;
+			std::atomic<std::uint64_t>* slot_;
+
+			read_guard(const epoch_graph& g, std::atomic<std::uint64_t>& slot)
+			: graph_(&g)
+			, slot_(&slot) {
+				g.domain_.pin(slot);
+			}
+		};
+
+		explicit epoch_graph(std::size_t buckets = 1024)
+		: buckets_(std::max(std::size_t{1}, buckets)) {
+			for (auto& bucket : buckets_) {
+				bucket.store(new bucket_block{}, std::memory_order_relaxed);
+			}
+		}
+		epoch_graph(std::initializer_list<N> il)
+		: epoch_graph() {
+			for (const auto& value : il) {
+				insert_node(value);
+			}
+		}
+		epoch_graph(const epoch_graph&) = delete;
+		auto operator=(const epoch_graph&) -> epoch_graph& = delete;
+		// Every reader must be gone by now.
+		~epoch_graph() {
+			for (auto& bucket : buckets_) {
+				delete bucket.load(std::memory_order_relaxed);
+			}
+			for (auto i = std::uint32_t{0}; i < next_; ++i) {
+				delete slot(i).out.load(std::memory_order_relaxed);
+			}
+		}
+
+		auto insert_node(const N& value) -> bool {
+			const auto lock = std::lock_guard{writer_};
+			if (find_index(value)) {
+				return false;
+			}
+			const auto index = allocate_slot();
+			slot(index).value.emplace(value);
+			const auto* old = bucket_of(value).load(std::memory_order_relaxed);
+			auto next = std::make_unique<bucket_block>(*old);
+			next->insert(std::upper_bound(next->begin(), next->end(), index, [&](std::uint32_t lhs, std::uint32_t rhs) {
+				             return *slot(lhs).value < *slot(rhs).value;
+			             }),
+			             index);
+			replace(bucket_of(value), std::move(next));
+			collect_if_due();
+			return true;
+		}
+		auto insert_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> bool {
+			const auto lock = std::lock_guard{writer_};
+			const auto src_index = find_index(src);
+			const auto dst_index = find_index(dst);
+			if (not src_index or not dst_index) {
+				throw std::runtime_error("Cannot call gdwg::epoch_graph<N, E>::insert_edge when either src or dst node "
+				                         "does not exist");
+			}
+			auto& out = slot(*src_index).out;
+			const auto* old = out.load(std::memory_order_relaxed);
+			auto next = old == nullptr ? std::make_unique<edge_block>() : std::make_unique<edge_block>(*old);
+			const auto entry = edge_entry{node_handle{*dst_index}, std::move(weight)};
+			const auto it = std::lower_bound(next->begin(), next->end(), entry, edge_less());
+			if (it != next->end() and it->to == entry.to and it->weight == entry.weight) {
+				return false;
+			}
+			next->insert(it, entry);
+			replace(out, std::move(next));
+			collect_if_due();
+			return true;
+		}
+		auto erase_node(const N& value) -> bool {
+			const auto lock = std::lock_guard{writer_};
+			const auto index = find_index(value);
+			if (not index) {
+				return false;
+			}
+			const auto* old = bucket_of(value).load(std::memory_order_relaxed);
+			auto next = std::make_unique<bucket_block>(*old);
+			std::erase(*next, *index);
+			replace(bucket_of(value), std::move(next));
+			replace(slot(*index).out, nullptr);
+			for (const auto& bucket : buckets_) {
+				for (const auto src : *bucket.load(std::memory_order_relaxed)) {
+					auto& out = slot(src).out;
+					const auto* edges = out.load(std::memory_order_relaxed);
+					const auto refers = [&](const edge_entry& entry) { return entry.to.index == *index; };
+					if (edges != nullptr and std::any_of(edges->begin(), edges->end(), refers)) {
+						auto kept = std::make_unique<edge_block>(*edges);
+						std::erase_if(*kept, refers);
+						replace(out, kept->empty() ? nullptr : std::move(kept));
+					}
+				}
+			}
+			retired_.push_back({domain_.now(), nullptr, nullptr, *index});
+			collect_if_due();
+			return true;
+		}
+		auto erase_edge(const N& src, const N& dst, std::optional<E> weight = std::nullopt) -> bool {
+			const auto lock = std::lock_guard{writer_};
+			const auto src_index = find_index(src);
+			const auto dst_index = find_index(dst);
+			if (not src_index or not dst_index) {
+				throw std::runtime_error("Cannot call gdwg::epoch_graph<N, E>::erase_edge on src or dst if they don't "
+				                         "exist in the graph");
+			}
+			auto& out = slot(*src_index).out;
+			const auto* old = out.load(std::memory_order_relaxed);
+			const auto entry = edge_entry{node_handle{*dst_index}, std::move(weight)};
+			if (old == nullptr) {
+				return false;
+			}
+			const auto it = std::lower_bound(old->begin(), old->end(), entry, edge_less());
+			if (it == old->end() or it->to != entry.to or it->weight != entry.weight) {
+				return false;
+			}
+			auto next = std::make_unique<edge_block>(*old);
+			next->erase(next->begin() + (it - old->begin()));
+			replace(out, next->empty() ? nullptr : std::move(next));
+			collect_if_due();
+			return true;
+		}
+		// Frees whatever no pinned reader can still see. Writers also call this every so often.
+		auto collect() -> void {
+			const auto lock = std::lock_guard{writer_};
+			collect_retired();
+		}
+		// The number of retired edge lists, buckets and node slots still waiting for readers to move on.
+		[[nodiscard]] auto pending_reclamation() const -> std::size_t {
+			const auto lock = std::lock_guard{writer_};
+			return retired_.size();
+		}
+		[[nodiscard]] auto to_graph() const -> graph<N, E> {
+			const auto lock = std::lock_guard{writer_};
+			auto res = graph<N, E>{};
+			for_each_node([&](std::uint32_t index) { res.insert_node(*slot(index).value); });
+			for_each_node([&](std::uint32_t index) {
+				if (const auto* out = slot(index).out.load(std::memory_order_relaxed); out != nullptr) {
+					for (const auto& [to, weight] : *out) {
+						res.insert_edge(*slot(index).value, *slot(to.index).value, weight);
+					}
+				}
+			});
+			return res;
+		}
+		friend auto operator<<(std::ostream& os, const epoch_graph& g) -> std::ostream& {
+			return os << g.to_graph();
+		}
+
+	 private:
+		// Edge lists and buckets are immutable once published; a write replaces the whole list.
+		using edge_block = std::vector<edge_entry>;
+		// The node slots hashed to one bucket, ordered by value.
+		using bucket_block = std::vector<std::uint32_t>;
+		struct node_slot {
+			std::optional<N> value;
+			std::atomic<const edge_block*> out{nullptr};
+		};
+		struct retired {
+			std::uint64_t epoch;
+			std::unique_ptr<const edge_block> edges;
+			std::unique_ptr<const bucket_block> bucket;
+			std::optional<std::uint32_t> slot;
+		};
+		// Slot chunks double in size, so a slot never moves and 32 chunk pointers cover every 32-bit index.
+		static constexpr auto first_chunk = std::uint32_t{64};
+		static constexpr auto retire_threshold = std::size_t{64};
+
+		// Registering a reader does not change the graph, so readers can be made from a const reference.
+		mutable detail::epoch_domain domain_;
+		std::vector<std::atomic<const bucket_block*>> buckets_;
+		std::array<std::atomic<node_slot*>, 32> chunks_{};
+		std::vector<std::unique_ptr<node_slot[]>> owned_chunks_;
+		std::uint32_t next_ = 0;
+		std::vector<std::uint32_t> free_;
+		std::vector<retired> retired_;
+		mutable std::mutex writer_;
+
+		[[nodiscard]] auto slot(std::uint32_t index) const -> node_slot& {
+			const auto offset = std::uint64_t{index} + first_chunk;
+			const auto chunk = static_cast<std::size_t>(std::bit_width(offset) - std::bit_width(first_chunk));
+			auto* slots = chunks_[chunk].load(std::memory_order_acquire);
+			return slots[offset - (std::uint64_t{first_chunk} << chunk)];
+		}
+		[[nodiscard]] auto bucket_of(const N& value) -> std::atomic<const bucket_block*>& {
+			return buckets_[std::hash<N>{}(value) % buckets_.size()];
+		}
+		[[nodiscard]] auto find_index(const N& value) const -> std::optional<std::uint32_t> {
+			const auto& bucket = *buckets_[std::hash<N>{}(value) % buckets_.size()].load(std::memory_order_seq_cst);
+			const auto it = std::lower_bound(bucket.begin(), bucket.end(), value, [&](std::uint32_t index, const N& v) {
+				return *slot(index).value < v;
+			});
+			return it != bucket.end() and *slot(*it).value == value ? std::optional{*it} : std::nullopt;
+		}
+		[[nodiscard]] auto edge_less() const {
+			return [this](const edge_entry& lhs, const edge_entry& rhs) {
+				if (lhs.to != rhs.to) {
+					return *slot(lhs.to.index).value < *slot(rhs.to.index).value;
+				}
+				return lhs.weight < rhs.weight;
+			};
+		}
+		template<typename F>
+		auto for_each_node(F fn) const -> void {
+			for (const auto& bucket : buckets_) {
+				for (const auto index : *bucket.load(std::memory_order_relaxed)) {
+					fn(index);
+				}
+			}
+		}
+		auto allocate_slot() -> std::uint32_t {
+			if (not free_.empty()) {
+				const auto index = free_.back();
+				free_.pop_back();
+				return index;
+			}
+			const auto index = next_++;
+			const auto offset = std::uint64_t{index} + first_chunk;
+			if (std::has_single_bit(offset)) {
+				const auto chunk = std::bit_width(offset) - std::bit_width(first_chunk);
+				owned_chunks_.push_back(std::make_unique<node_slot[]>(offset));
+				chunks_[static_cast<std::size_t>(chunk)].store(owned_chunks_.back().get(), std::memory_order_release);
+			}
+			return index;
+		}
+		// Publishes next in place of the current list and retires the old one.
+		template<typename T>
+		auto replace(std::atomic<const T*>& target, std::type_identity_t<std::unique_ptr<T>> next) -> void {
+			const auto* old = target.exchange(next.release(), std::memory_order_seq_cst);
+			if (old != nullptr) {
+				auto entry = retired{domain_.now(), nullptr, nullptr, std::nullopt};
+				if constexpr (std::is_same_v<T, edge_block>) {
+					entry.edges.reset(old);
+				}
+				else {
+					entry.bucket.reset(old);
+				}
+				retired_.push_back(std::move(entry));
+			}
+		}
+		auto collect_if_due() -> void {
+			if (retired_.size() >= retire_threshold) {
+				collect_retired();
+			}
+		}
+		auto collect_retired() -> void {
+			const auto safe = domain_.advance();
+			std::erase_if(retired_, [&](retired& entry) {
+				if (entry.epoch >= safe) {
+					return false;
+				}
+				if (entry.slot) {
+					slot(*entry.slot).value.reset();
+					free_.push_back(*entry.slot);
+				}
+				return true;
+			});
+		}
+	};
+	// Where a partitioned_graph puts each partition's memory. local places a partition on the NUMA node whose
+	// CPUs own it; interleaved spreads every partition's pages across all nodes, as a baseline to compare with.
+	enum class placement { local, interleaved };
+	struct partition_options {
+		// 0 means one partition per NUMA node.
+		std::size_t partitions = 0;
+		placement memory = placement::local;
+	};
+	namespace detail {
+		struct numa_node {
+			unsigned id;
+			std::vector<unsigned> cpus;
+		};
+		// Parses a sysfs CPU list such as "0-3,8,10-11".
+		inline auto parse_cpu_list(const std::string& list) -> std::vector<unsigned> {
+			auto res = std::vector<unsigned>{};
+			auto in = std::istringstream{list};
+			auto range = std::string{};
+			while (std::getline(in, range, ',')) {
+				if (range.find_first_of("0123456789") == std::string::npos) {
+					continue;
+				}
+				const auto dash = range.find('-');
+				const auto first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+				const auto last =
+				    dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+				for (auto cpu = first; cpu <= last; ++cpu) {
+					res.push_back(cpu);
+				}
+			}
+			return res;
+		}
+		// The memory nodes with CPUs, read from sysfs on Linux. Elsewhere, or if sysfs is unreadable, a single
+		// node holding every CPU.
+		inline auto numa_topology() -> std::vector<numa_node> {
+			auto res = std::vector<numa_node>{};
+#if defined(__linux__)
+			auto online = std::ifstream{"/sys/devices/system/node/online"};
+			auto ids = std::string{};
+			if (std::getline(online, ids)) {
+				for (const auto id : parse_cpu_list(ids)) {
+					auto file = std::ifstream{"/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"};
+					auto cpus = std::string{};
+					if (std::getline(file, cpus) and not parse_cpu_list(cpus).empty()) {
+						res.push_back({id, parse_cpu_list(cpus)});
+					}
+				}
+			}
+#endif
+			if (res.empty()) {
+				auto all = numa_node{0, {}};
+				for (auto cpu = 0U; cpu < std::max(1U, std::thread::hardware_concurrency()); ++cpu) {
+					all.cpus.push_back(cpu);
+				}
+				res.push_back(std::move(all));
+			}
+			return res;
+		}
+		// Pins the calling thread to node's CPUs and sets the memory policy for the pages it touches next. Both
+		// are best effort: a container that forbids them just loses the placement.
+		inline auto bind_to_node(const numa_node& node, placement memory, const std::vector<numa_node>& topology)
+		    -> void {
+#if defined(__linux__)
+			auto cpus = cpu_set_t{};
+			CPU_ZERO(&cpus);
+			for (const auto cpu : node.cpus) {
+				if (cpu < CPU_SETSIZE) {
+					CPU_SET(cpu, &cpus);
+				}
+			}
+			pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+			constexpr auto mask_bits = std::numeric_limits<unsigned long>::digits;
+			auto mask = 0UL;
+			const auto add = [&](unsigned id) {
+				if (id < static_cast<unsigned>(mask_bits)) {
+					mask |= 1UL << id;
+				}
+			};
+			if (memory == placement::local) {
+				add(node.id);
+			}
+			else {
+				for (const auto& other : topology) {
+					add(other.id);
+				}
+			}
+			const auto mode = static_cast<int>(memory == placement::local ? MPOL_PREFERRED : MPOL_INTERLEAVE);
+			syscall(SYS_set_mempolicy, mode, &mask, static_cast<unsigned long>(mask_bits));
+#else
+			static_cast<void>(node);
+			static_cast<void>(memory);
+			static_cast<void>(topology);
+#endif
+		}
+	} // namespace detail
+	// A read-only copy of a graph split into partitions, each stored compactly (sorted nodes, CSR edges) in
+	// memory on the NUMA node that owns it. Nodes go to partitions by hash or by a caller's partitioner, and
+	// partition-parallel work runs on one thread per partition pinned to the owning node's CPUs, so each
+	// thread mostly reads local memory. src/partition_benchmark.cpp compares local and interleaved placement;
+	// it has only been run on a single NUMA node so far, so the cross-socket speed-up is still unmeasured.
+	template<typename N, typename E>
+	class partitioned_graph {
+	 public:
+		struct vertex {
+			std::uint32_t partition;
+			std::uint32_t index;
+			auto operator==(const vertex&) const -> bool = default;
+		};
+		struct partition {
+			// Sorted, so vertex indices follow node order.
+			std::vector<N> nodes;
+			// Node i's edges are [offsets[i], offsets[i + 1]) of targets and weights, in the usual edge order.
+			std::vector<std::size_t> offsets;
+			std::vector<vertex> targets;
+			std::vector<std::optional<E>> weights;
+		};
+
+		explicit partitioned_graph(const graph<N, E>& g, const partition_options& options = {})
+		: partitioned_graph(g, hash_partitioner(partition_count(options)), options) {}
+		// partitioner(value) must return the same partition in [0, partitions) for equal values.
+		template<typename Partitioner>
+		partitioned_graph(const graph<N, E>& g, Partitioner partitioner, const partition_options& options = {})
+		: topology_(detail::numa_topology())
+		, partitioner_(std::move(partitioner))
+		, parts_(options.partitions != 0 ? options.partitions : topology_.size()) {
+			auto members = std::vector<std::vector<const std::shared_ptr<N>*>>(parts_.size());
+			auto where = std::unordered_map<const N*, vertex>{};
+			for (const auto& node : detail::graph_access::nodes(g)) {
+				const auto p = partitioner_(*node);
+				if (p >= parts_.size()) {
+					throw std::runtime_error("Cannot construct gdwg::partitioned_graph<N, E> with a partitioner that "
+					                         "returns a partition out of range");
+				}
+				const auto index = static_cast<std::uint32_t>(members[p].size());
+				where.emplace(node.get(), vertex{static_cast<std::uint32_t>(p), index});
+				members[p].push_back(&node);
+			}
+			const auto& edges = detail::graph_access::edges(g);
+			// Each partition is built by a thread bound to its node, so its pages are first touched there.
+			run_bound(options.memory, [&](std::size_t p) {
+				auto& part = parts_[p];
+				part.nodes.reserve(members[p].size());
+				part.offsets.reserve(members[p].size() + 1);
+				part.offsets.push_back(0);
+				for (const auto* node : members[p]) {
+					part.nodes.push_back(**node);
+					if (const auto it = edges.find(*node); it != edges.end()) {
+						for (const auto& [dst, weight] : it->second) {
+							part.targets.push_back(where.at(dst.get()));
+							part.weights.push_back(weight);
+						}
+					}
+					part.offsets.push_back(part.targets.size());
+				}
+			});
+		}
+
+		[[nodiscard]] auto partitions() const noexcept -> std::size_t {
+			return parts_.size();
+		}
+		[[nodiscard]] auto partition_at(std::size_t p) const -> const partition& {
+			return parts_.at(p);
+		}
+		// The NUMA node id partition p is placed on and whose CPUs run its work.
+		[[nodiscard]] auto numa_node_of(std::size_t p) const -> unsigned {
+			return topology_[p % topology_.size()].id;
+		}
+		[[nodiscard]] auto find(const N& value) const -> std::optional<vertex> {
+			const auto p = partitioner_(value);
+			if (p >= parts_.size()) {
+				return std::nullopt;
+			}
+			const auto& nodes = parts_[p].nodes;
+			const auto it = std::lower_bound(nodes.begin(), nodes.end(), value);
+			if (it == nodes.end() or *it != value) {
+				return std::nullopt;
+			}
+			return vertex{static_cast<std::uint32_t>(p), static_cast<std::uint32_t>(it - nodes.begin())};
+		}
+		[[nodiscard]] auto value(vertex v) const -> const N& {
+			return parts_[v.partition].nodes[v.index];
+		}
+		[[nodiscard]] auto is_node(const N& value) const -> bool {
+			return find(value).has_value();
+		}
+		[[nodiscard]] auto empty() const noexcept -> bool {
+			return std::all_of(parts_.begin(), parts_.end(), [](const partition& part) { return part.nodes.empty(); });
+		}
+		[[nodiscard]] auto is_connected(const N& src, const N& dst) const -> bool {
+			const auto from = find(src);
+			const auto to = find(dst);
+			if (not from or not to) {
+				throw std::runtime_error("Cannot call gdwg::partitioned_graph<N, E>::is_connected if src or dst node "
+				                         "don't exist in the graph");
+			}
+			const auto [first, last] = edge_range(*from);
+			return std::find(first, last, *to) != last;
+		}
+		[[nodiscard]] auto connections(const N& src) const -> std::vector<N> {
+			const auto from = find(src);
+			if (not from) {
+				throw std::runtime_error("Cannot call gdwg::partitioned_graph<N, E>::connections if src doesn't exist "
+				                         "in the graph");
+			}
+			auto res = std::vector<N>{};
+			const auto [first, last] = edge_range(*from);
+			for (auto it = first; it != last; ++it) {
+				if (res.empty() or res.back() != value(*it)) {
+					res.push_back(value(*it));
+				}
+			}
+			return res;
+		}
+		// Calls fn(p) for every partition p at once, each on its own thread pinned to p's NUMA node. fn must be
+		// safe to call concurrently; the first exception thrown is rethrown once every thread has finished.
+		template<typename F>
+		auto for_each_partition(F fn) const -> void {
+			run_bound(placement::local, fn);
+		}
+		// Hop counts from src along outgoing edges. Level-synchronous BFS in which each partition's thread
+		// expands only its own frontier and hands discoveries in other partitions to their owners.
+		[[nodiscard]] auto hop_counts(const N& src) const -> std::map<N, std::size_t> {
+			const auto start = find(src);
+			if (not start) {
+				throw std::runtime_error("Cannot call gdwg::partitioned_graph<N, E>::hop_counts if src doesn't exist "
+				                         "in the graph");
+			}
+			constexpr auto unseen = std::numeric_limits<std::size_t>::max();
+			const auto count = parts_.size();
+			auto hops = std::vector<std::vector<std::size_t>>(count);
+			auto frontier = std::vector<std::vector<std::uint32_t>>(count);
+			// outboxes[from * count + to] holds vertices of partition `to` found by partition `from`.
+			auto outboxes = std::vector<std::vector<std::uint32_t>>(count * count);
+			auto found = std::atomic<std::size_t>{1};
+			auto level = std::size_t{0};
+			auto exchanged = std::barrier<>(static_cast<std::ptrdiff_t>(count));
+			// The last thread to arrive ends the search when the previous level found nothing.
+			auto advance = std::barrier(static_cast<std::ptrdiff_t>(count), [&]() noexcept {
+				if (found.exchange(0) != 0) {
+					++level;
+				}
+			});
+			// A thread that stops early, because it threw or saw that another did, drops out of both barriers so
+			// the others are never left waiting for it; they see the flag after their next barrier and stop too.
+			auto aborted = std::atomic<bool>{false};
+			const auto leave = [&] {
+				aborted.store(true);
+				advance.arrive_and_drop();
+				exchanged.arrive_and_drop();
+			};
+			for_each_partition([&](std::size_t p) {
+				try {
+					hops[p].assign(parts_[p].nodes.size(), unseen);
+					if (start->partition == p) {
+						hops[p][start->index] = 0;
+						frontier[p].push_back(start->index);
+					}
+					for (auto depth = std::size_t{0};; ++depth) {
+						advance.arrive_and_wait();
+						if (aborted.load()) {
+							return leave();
+						}
+						if (level == depth) {
+							break;
+						}
+						auto next = std::vector<std::uint32_t>{};
+						for (const auto u : frontier[p]) {
+							const auto [first, last] = edge_range(vertex{static_cast<std::uint32_t>(p), u});
+							for (auto it = first; it != last; ++it) {
+								if (it->partition != p) {
+									outboxes[p * count + it->partition].push_back(it->index);
+								}
+								else if (hops[p][it->index] == unseen) {
+									hops[p][it->index] = depth + 1;
+									next.push_back(it->index);
+								}
+							}
+						}
+						exchanged.arrive_and_wait();
+						if (aborted.load()) {
+							return leave();
+						}
+						for (auto from = std::size_t{0}; from < count; ++from) {
+							auto& inbox = outboxes[from * count + p];
+							for (const auto v : inbox) {
+								if (hops[p][v] == unseen) {
+									hops[p][v] = depth + 1;
+									next.push_back(v);
+								}
+							}
+							inbox.clear();
+						}
+						frontier[p] = std::move(next);
+						if (not frontier[p].empty()) {
+							found.fetch_add(frontier[p].size());
+						}
+					}
+				} catch (...) {
+					leave();
+					throw;
+				}
+			});
+			auto res = std::map<N, std::size_t>{};
+			for (auto p = std::size_t{0}; p < count; ++p) {
+				for (auto i = std::size_t{0}; i < hops[p].size(); ++i) {
+					if (hops[p][i] != unseen) {
+						res.emplace(parts_[p].nodes[i], hops[p][i]);
+					}
+				}
+			}
+			return res;
+		}
+		[[nodiscard]] auto to_graph() const -> graph<N, E> {
+			auto res = graph<N, E>{};
+			for (const auto& part : parts_) {
+				for (const auto& node : part.nodes) {
+					res.insert_node(node);
+				}
+			}
+			for (const auto& part : parts_) {
+				for (auto i = std::size_t{0}; i < part.nodes.size(); ++i) {
+					for (auto e = part.offsets[i]; e < part.offsets[i + 1]; ++e) {
+						res.insert_edge(part.nodes[i], value(part.targets[e]), part.weights[e]);
+					}
+				}
+			}
+			return res;
+		}
+		friend auto operator<<(std::ostream& os, const partitioned_graph& g) -> std::ostream& {
+			return os << g.to_graph();
+		}
+
+	 private:
+		std::vector<detail::numa_node> topology_;
+		std::function<std::size_t(const N&)> partitioner_;
+		std::vector<partition> parts_;
+
+		static auto partition_count(const partition_options& options) -> std::size_t {
+			return options.partitions != 0 ? options.partitions : detail::numa_topology().size();
+		}
+		static auto hash_partitioner(std::size_t count) {
+			return [count](const N& value) { return std::hash<N>{}(value) % count; };
+		}
+		[[nodiscard]] auto edge_range(vertex v) const {
+			const auto& part = parts_[v.partition];
+			return std::pair{part.targets.begin() + static_cast<std::ptrdiff_t>(part.offsets[v.index]),
+			                 part.targets.begin() + static_cast<std::ptrdiff_t>(part.offsets[v.index + 1])};
+		}
+		template<typename F>
+		auto run_bound(placement memory, F&& fn) const -> void {
+			auto errors = std::vector<std::exception_ptr>(parts_.size());
+			auto threads = std::vector<std::thread>{};
+			threads.reserve(parts_.size());
+			for (auto p = std::size_t{0}; p < parts_.size(); ++p) {
+				threads.emplace_back([&, p] {
+					detail::bind_to_node(topology_[p % topology_.size()], memory, topology_);
+					try {
+						fn(p);
+					} catch (...) {
+						errors[p] = std::current_exception();
+					}
+				});
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			for (const auto& error : errors) {
+				if (error) {
+					std::rethrow_exception(error);
+				}
+			}
+		}
+	};
+	namespace detail {
+		// The on-disk layout shared by graph::save_binary and graph_view. A 128-byte header is followed by
+		// sections that each start on a 64-byte boundary:
+		//   nodes     the node column, in sorted order
+		//   offsets   node_count + 1 u64s; node i's edges are [offsets[i], offsets[i + 1])
+		//   targets   edge_count u32 node indices, in the usual edge order
+		//   weighted  edge_count bytes, 1 where the edge has a weight
+		//   weights   the weight column, holding 0 or "" for unweighted edges
+		// An arithmetic column is count fixed-size values. A string column is count + 1 u64 offsets into the
+		// characters that follow it. Every number is little-endian.
+		struct binary_layout {
+			static constexpr auto magic = std::array<char, 8>{'G', 'D', 'W', 'G', 'C', 'S', 'R', '\0'};
+			static constexpr auto version = std::uint32_t{1};
+			static constexpr auto header_size = std::uint64_t{128};
+			static constexpr auto alignment = std::uint64_t{64};
+			// Byte positions of the header fields after the magic.
+			static constexpr auto version_at = std::size_t{8};
+			static constexpr auto node_type_at = std::size_t{12};
+			static constexpr auto weight_type_at = std::size_t{16};
+			static constexpr auto node_count_at = std::size_t{24};
+			static constexpr auto edge_count_at = std::size_t{32};
+			static constexpr auto nodes_at = std::size_t{40};
+			static constexpr auto offsets_at = std::size_t{48};
+			static constexpr auto targets_at = std::size_t{56};
+			static constexpr auto weighted_at = std::size_t{64};
+			static constexpr auto weights_at = std::size_t{72};
+			static constexpr auto file_size_at = std::size_t{80};
+
+			static constexpr auto align(std::uint64_t offset) -> std::uint64_t {
+				return (offset + alignment - 1) / alignment * alignment;
+			}
+		};
+		// Identifies a column's type in the header: the kind in the high byte, the size in the low byte.
+		template<binary_value T>
+		constexpr auto binary_type_tag() -> std::uint32_t {
+			if constexpr (std::is_same_v<T, std::string>) {
+				return 4U << 8U;
+			}
+			else {
+				const auto kind = std::is_floating_point_v<T> ? 3U : std::is_signed_v<T> ? 1U : 2U;
+				return kind << 8U | static_cast<std::uint32_t>(sizeof(T));
+			}
+		}
+		template<typename T>
+		auto store_little(T value) -> std::array<char, sizeof(T)> {
+			auto bytes = std::bit_cast<std::array<char, sizeof(T)>>(value);
+			if constexpr (std::endian::native == std::endian::big) {
+				std::reverse(bytes.begin(), bytes.end());
+			}
+			return bytes;
+		}
+		template<typename T>
+		auto load_little(const char* data) -> T {
+			auto bytes = std::array<char, sizeof(T)>{};
+			std::memcpy(bytes.data(), data, sizeof(T));
+			if constexpr (std::endian::native == std::endian::big) {
+				std::reverse(bytes.begin(), bytes.end());
+			}
+			return std::bit_cast<T>(bytes);
+		}
+		// The bytes a column of count values takes, where chars is the total length of the strings.
+		template<binary_value T>
+		auto column_size(std::uint64_t count, std::uint64_t chars) -> std::uint64_t {
+			if constexpr (std::is_same_v<T, std::string>) {
+				return (count + 1) * sizeof(std::uint64_t) + chars;
+			}
+			else {
+				static_cast<void>(chars);
+				return count * sizeof(T);
+			}
+		}
+		class binary_writer {
+		 public:
+			explicit binary_writer(const std::string& path)
+			: out_(path, std::ios::binary | std::ios::trunc) {}
+			[[nodiscard]] auto good() const -> bool {
+				return out_.good();
+			}
+			template<typename T>
+			auto put(T value) -> void {
+				const auto bytes = store_little(value);
+				write(bytes.data(), bytes.size());
+			}
+			auto write(const char* data, std::size_t size) -> void {
+				out_.write(data, static_cast<std::streamsize>(size));
+				position_ += size;
+			}
+			auto pad_to(std::uint64_t offset) -> void {
+				static constexpr auto zeros = std::array<char, binary_layout::alignment>{};
+				while (position_ < offset) {
+					write(zeros.data(), std::min<std::uint64_t>(zeros.size(), offset - position_));
+				}
+			}
+			// Writes a column of the values that each(visit) passes to visit, in order. A string column calls each
+			// twice, once for the offsets and once for the characters.
+			template<binary_value T, typename F>
+			auto column(F each) -> void {
+				if constexpr (std::is_same_v<T, std::string>) {
+					auto start = std::uint64_t{0};
+					each([&](const std::string& text) {
+						put(start);
+						start += text.size();
+					});
+					put(start);
+					each([&](const std::string& text) { write(text.data(), text.size()); });
+				}
+				else {
+					each([&](const auto& value) { put(static_cast<T>(value)); });
+				}
+			}
+			auto flush() -> void {
+				out_.flush();
+			}
+
+		 private:
+			std::ofstream out_;
+			std::uint64_t position_ = 0;
+		};
+		template<typename N, typename E>
+		auto save_binary(const graph<N, E>& g, const std::string& path) -> void {
+			using layout = binary_layout;
+			const auto& nodes = graph_access::nodes(g);
+			const auto& edges = graph_access::edges(g);
+			if (nodes.size() > std::numeric_limits<std::uint32_t>::max()) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::save_binary on a graph with more nodes than "
+				                         "a u32 can index");
+			}
+			// Node ranks sorted by address, to look up edge targets: one entry per node rather than per edge.
+			auto ranks = std::vector<std::pair<const N*, std::uint32_t>>{};
+			auto out_edges = std::vector<const typename std::remove_cvref_t<decltype(edges)>::mapped_type*>{};
+			auto node_chars = std::uint64_t{0};
+			auto edge_count = std::uint64_t{0};
+			auto weight_chars = std::uint64_t{0};
+			ranks.reserve(nodes.size());
+			out_edges.reserve(nodes.size());
+			for (const auto& node : nodes) {
+				ranks.emplace_back(node.get(), static_cast<std::uint32_t>(ranks.size()));
+				const auto it = edges.find(node);
+				out_edges.push_back(it != edges.end() ? &it->second : nullptr);
+				if constexpr (std::is_same_v<N, std::string>) {
+					node_chars += node->size();
+				}
+				if (it == edges.end()) {
+					continue;
+				}
+				edge_count += it->second.size();
+				if constexpr (std::is_same_v<E, std::string>) {
+					for (const auto& [dst, weight] : it->second) {
+						weight_chars += weight ? weight->size() : 0;
+					}
+				}
+			}
+			const auto by_address = [](const auto& rank, const N* node) {
+				return std::less<const N*>{}(rank.first, node);
+			};
+			std::sort(ranks.begin(), ranks.end(), [&](const auto& a, const auto& b) { return by_address(a, b.first); });
+			const auto rank_of = [&](const N* node) {
+				return std::lower_bound(ranks.begin(), ranks.end(), node, by_address)->second;
+			};
+			const auto for_each_edge = [&](auto fn) {
+				for (const auto* out_set : out_edges) {
+					if (out_set != nullptr) {
+						std::for_each(out_set->begin(), out_set->end(), fn);
+					}
+				}
+			};
+			const auto node_count = std::uint64_t{nodes.size()};
+			const auto nodes_at = layout::header_size;
+			const auto offsets_at = layout::align(nodes_at + column_size<N>(node_count, node_chars));
+			const auto targets_at = layout::align(offsets_at + (node_count + 1) * sizeof(std::uint64_t));
+			const auto weighted_at = layout::align(targets_at + edge_count * sizeof(std::uint32_t));
+			const auto weights_at = layout::align(weighted_at + edge_count);
+			const auto file_size = weights_at + column_size<E>(edge_count, weight_chars);
+
+			auto out = binary_writer(path);
+			if (not out.good()) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::save_binary if the file cannot be written");
+			}
+			out.write(layout::magic.data(), layout::magic.size());
+			out.put(layout::version);
+			out.put(binary_type_tag<N>());
+			out.put(binary_type_tag<E>());
+			out.put(std::uint32_t{0});
+			for (const auto field :
+			     {node_count, edge_count, nodes_at, offsets_at, targets_at, weighted_at, weights_at, file_size}) {
+				out.put(field);
+			}
+			out.pad_to(nodes_at);
+			out.column<N>([&](auto visit) {
+				for (const auto& node : nodes) {
+					visit(*node);
+				}
+			});
+			out.pad_to(offsets_at);
+			auto offset = std::uint64_t{0};
+			for (const auto* out_set : out_edges) {
+				out.put(offset);
+				offset += out_set != nullptr ? out_set->size() : 0;
+			}
+			out.put(offset);
+			// The remaining sections are each one pass over the edges in order.
+			out.pad_to(targets_at);
+			for_each_edge([&](const auto& entry) { out.put(rank_of(entry.first.get())); });
+			out.pad_to(weighted_at);
+			for_each_edge([&](const auto& entry) { out.put(static_cast<std::uint8_t>(entry.second.has_value())); });
+			out.pad_to(weights_at);
+			const auto unweighted = E{};
+			out.column<E>([&](auto visit) {
+				for_each_edge([&](const auto& entry) { visit(entry.second ? *entry.second : unweighted); });
+			});
+			out.flush();
+			if (not out.good()) {
+				throw std::runtime_error("Cannot call gdwg::graph<N, E>::save_binary if the file cannot be written");
+			}
+		}
+	} // namespace detail
+	// A read-only graph served straight from a file written by graph::save_binary. open_mmap maps the file and
+	// checks its header and section bounds; queries then read the mapped arrays in place, so opening costs the
+	// same however large the graph is. Each offset, target and string position a query reads is checked as it is
+	// read, and a corrupt one throws the same error as open_mmap does for a file that is not a graph. String
+	// nodes and weights are returned as views into the mapping, valid while the graph_view lives.
+	template<typename N, typename E>
+	class graph_view {
+	 public:
+		using node_ref = std::conditional_t<std::is_same_v<N, std::string>, std::string_view, N>;
+		using weight_ref = std::conditional_t<std::is_same_v<E, std::string>, std::string_view, E>;
+
+		[[nodiscard]] static auto open_mmap(const std::string& path) -> graph_view {
+			auto res = graph_view{};
+			res.map(path);
+			res.check();
+			return res;
+		}
+		graph_view(graph_view&& other) noexcept
+		: data_(std::exchange(other.data_, nullptr))
+		, size_(std::exchange(other.size_, 0))
+		, buffer_(std::move(other.buffer_))
+		, node_count_(other.node_count_)
+		, edge_count_(other.edge_count_)
+		, nodes_(other.nodes_)
+		, offsets_(other.offsets_)
+		, targets_(other.targets_)
+		, weighted_(other.weighted_)
+		, weights_(other.weights_) {}
+		auto operator=(graph_view&& other) noexcept -> graph_view& {
+			if (this != &other) {
+				unmap();
+				data_ = std::exchange(other.data_, nullptr);
+				size_ = std::exchange(other.size_, 0);
+				buffer_ = std::move(other.buffer_);
+				node_count_ = other.node_count_;
+				edge_count_ = other.edge_count_;
+				nodes_ = other.nodes_;
+				offsets_ = other.offsets_;
+				targets_ = other.targets_;
+				weighted_ = other.weighted_;
+				weights_ = other.weights_;
+			}
+			return *this;
+		}
+		graph_view(const graph_view&) = delete;
+		auto operator=(const graph_view&) -> graph_view& = delete;
+		~graph_view() {
+			unmap();
+		}
+
+		[[nodiscard]] auto node_count() const noexcept -> std::size_t {
+			return static_cast<std::size_t>(node_count_);
+		}
+		[[nodiscard]] auto edge_count() const noexcept -> std::size_t {
+			return static_cast<std::size_t>(edge_count_);
+		}
+		[[nodiscard]] auto empty() const noexcept -> bool {
+			return node_count_ == 0;
+		}
+		// The i-th node in sorted order.
+		[[nodiscard]] auto node(std::size_t i) const -> node_ref {
+			return column<N>(nodes_, node_count_, i);
+		}
+		[[nodiscard]] auto is_node(const N& value) const -> bool {
+			return find(value).has_value();
+		}
+		[[nodiscard]] auto nodes() const -> std::vector<N> {
+			auto res = std::vector<N>{};
+			res.reserve(node_count());
+			for (auto i = std::size_t{0}; i < node_count(); ++i) {
+				res.emplace_back(node(i));
+			}
+			return res;
+		}
+		[[nodiscard]] auto is_connected(const N& src, const N& dst) const -> bool {
+			const auto from = find(src);
+			const auto to = find(dst);
+			if (not from or not to) {
+				throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::is_connected if src or dst node don't "
+				                         "exist in the graph");
+			}
+			const auto [first, last] = edge_range(*from);
+			const auto e = first_edge_to(first, last, *to);
+			return e != last and target(e) == *to;
+		}
+		[[nodiscard]] auto edges(const N& src, const N& dst) const -> std::vector<std::unique_ptr<edge<N, E>>> {
+			const auto from = find(src);
+			const auto to = find(dst);
+			if (not from or not to) {
+				throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::edges if src or dst node don't exist in "
+				                         "the graph");
+			}
+			auto res = std::vector<std::unique_ptr<edge<N, E>>>{};
+			const auto [first, last] = edge_range(*from);
+			for (auto e = first_edge_to(first, last, *to); e != last and target(e) == *to; ++e) {
+				if (is_weighted(e)) {
+					res.emplace_back(std::make_unique<weighted_edge<N, E>>(src, dst, E(weight(e))));
+				}
+				else {
+					res.emplace_back(std::make_unique<unweighted_edge<N, E>>(src, dst));
+				}
+			}
+			return res;
+		}
+		[[nodiscard]] auto connections(const N& src) const -> std::vector<N> {
+			const auto from = find(src);
+			if (not from) {
+				throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::connections if src doesn't exist in the "
+				                         "graph");
+			}
+			auto res = std::vector<N>{};
+			const auto [first, last] = edge_range(*from);
+			for (auto e = first; e != last; ++e) {
+				if (e == first or target(e) != target(e - 1)) {
+					res.emplace_back(node(target(e)));
+				}
+			}
+			return res;
+		}
+		[[nodiscard]] auto to_graph() const -> graph<N, E> {
+			auto res = graph<N, E>{};
+			for (auto i = std::size_t{0}; i < node_count(); ++i) {
+				res.insert_node(N(node(i)));
+			}
+			for (auto i = std::size_t{0}; i < node_count(); ++i) {
+				const auto [first, last] = edge_range(i);
+				for (auto e = first; e != last; ++e) {
+					const auto weight_value = is_weighted(e) ? std::optional<E>(E(weight(e))) : std::nullopt;
+					res.insert_edge(N(node(i)), N(node(target(e))), weight_value);
+				}
+			}
+			return res;
+		}
+		// The same text as operator<< on the saved graph, read straight from the mapping.
+		friend auto operator<<(std::ostream& os, const graph_view& g) -> std::ostream& {
+			for (auto i = std::size_t{0}; i < g.node_count(); ++i) {
+				os << g.node(i) << " (\n";
+				const auto [first, last] = g.edge_range(i);
+				for (auto e = first; e != last; ++e) {
+					if (not g.is_weighted(e)) {
+						os << "  " << g.node(i) << " -> " << g.node(g.target(e)) << " | U\n";
+					}
+				}
+				for (auto e = first; e != last; ++e) {
+					if (g.is_weighted(e)) {
+						os << "  " << g.node(i) << " -> " << g.node(g.target(e)) << " | W | " << g.weight(e) << "\n";
+					}
+				}
+				os << ")\n";
+			}
+			return os;
+		}
+
+	 private:
+		using layout = detail::binary_layout;
+		const char* data_ = nullptr;
+		std::size_t size_ = 0;
+		// Holds the file where it cannot be mapped.
+		std::unique_ptr<char[]> buffer_;
+		std::uint64_t node_count_ = 0;
+		std::uint64_t edge_count_ = 0;
+		std::uint64_t nodes_ = 0;
+		std::uint64_t offsets_ = 0;
+		std::uint64_t targets_ = 0;
+		std::uint64_t weighted_ = 0;
+		std::uint64_t weights_ = 0;
+
+		graph_view() = default;
+		auto map(const std::string& path) -> void {
+#if defined(__linux__)
+			const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			struct stat info = {};
+			if (fd < 0 or ::fstat(fd, &info) != 0) {
+				if (fd >= 0) {
+					::close(fd);
+				}
+				throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::open_mmap if the file cannot be opened");
+			}
+			size_ = static_cast<std::size_t>(info.st_size);
+			auto* mapped = size_ == 0 ? MAP_FAILED : ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (mapped == MAP_FAILED) {
+				size_ = 0;
+				throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::open_mmap if the file is not a gdwg "
+				                         "binary graph");
+			}
+			data_ = static_cast<const char*>(mapped);
+#else
+			auto in = std::ifstream(path, std::ios::binary | std::ios::ate);
+			if (not in) {
+				throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::open_mmap if the file cannot be opened");
+			}
+			size_ = static_cast<std::size_t>(in.tellg());
+			buffer_ = std::make_unique<char[]>(size_);
+			in.seekg(0);
+			in.read(buffer_.get(), static_cast<std::streamsize>(size_));
+			data_ = buffer_.get();
+#endif
+		}
+		auto unmap() noexcept -> void {
+#if defined(__linux__)
+			if (data_ != nullptr and buffer_ == nullptr) {
+				::munmap(const_cast<char*>(data_), size_);
+			}
+#endif
+			data_ = nullptr;
+			buffer_.reset();
+		}
+		[[noreturn]] static auto invalid() -> void {
+			throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::open_mmap if the file is not a gdwg binary "
+			                         "graph");
+		}
+		// Reads the header and checks that every section lies inside the file, without touching the sections.
+		// The values inside them are checked as they are read.
+		auto check() -> void {
+			if (size_ < layout::header_size or not std::equal(layout::magic.begin(), layout::magic.end(), data_)
+			    or load<std::uint32_t>(layout::version_at) != layout::version)
+			{
+				invalid();
+			}
+			if (load<std::uint32_t>(layout::node_type_at) != detail::binary_type_tag<N>()
+			    or load<std::uint32_t>(layout::weight_type_at) != detail::binary_type_tag<E>())
+			{
+				throw std::runtime_error("Cannot call gdwg::graph_view<N, E>::open_mmap if the file was saved with "
+				                         "different node or weight types");
+			}
+			node_count_ = load<std::uint64_t>(layout::node_count_at);
+			edge_count_ = load<std::uint64_t>(layout::edge_count_at);
+			nodes_ = load<std::uint64_t>(layout::nodes_at);
+			offsets_ = load<std::uint64_t>(layout::offsets_at);
+			targets_ = load<std::uint64_t>(layout::targets_at);
+			weighted_ = load<std::uint64_t>(layout::weighted_at);
+			weights_ = load<std::uint64_t>(layout::weights_at);
+			const auto size = std::uint64_t{size_};
+			// Bounds the counts first so the section sizes below cannot overflow.
+			if (load<std::uint64_t>(layout::file_size_at) != size or node_count_ > size or edge_count_ > size) {
+				invalid();
+			}
+			const auto fits = [&](std::uint64_t at, std::uint64_t bytes) {
+				return at >= layout::header_size and at <= size and bytes <= size - at;
+			};
+			if (not fits(nodes_, column_fixed_size<N>(node_count_))
+			    or not fits(offsets_, (node_count_ + 1) * sizeof(std::uint64_t))
+			    or not fits(targets_, edge_count_ * sizeof(std::uint32_t)) or not fits(weighted_, edge_count_)
+			    or not fits(weights_, column_fixed_size<E>(edge_count_))
+			    or load<std::uint64_t>(offsets_ + node_count_ * sizeof(std::uint64_t)) != edge_count_
+			    // The character counts are read from the file, so they are compared with the space left rather
+			    // than added to the fixed sizes, where a huge count could wrap around.
+			    or column_chars<N>(nodes_, node_count_) > size - nodes_ - column_fixed_size<N>(node_count_)
+			    or column_chars<E>(weights_, edge_count_) > size - weights_ - column_fixed_size<E>(edge_count_))
+			{
+				invalid();
+			}
+		}
+		template<typename T>
+		[[nodiscard]] auto load(std::uint64_t at) const -> T {
+			return detail::load_little<T>(data_ + at);
+		}
+		// The part of a column before any string characters.
+		template<typename T>
+		static auto column_fixed_size(std::uint64_t count) -> std::uint64_t {
+			return detail::column_size<T>(count, 0);
+		}
+		template<typename T>
+		[[nodiscard]] auto column_chars(std::uint64_t at, std::uint64_t count) const -> std::uint64_t {
+			if constexpr (std::is_same_v<T, std::string>) {
+				return load<std::uint64_t>(at + count * sizeof(std::uint64_t));
+			}
+			else {
+				static_cast<void>(at);
+				static_cast<void>(count);
+				return 0;
+			}
+		}
+		template<typename T>
+		[[nodiscard]] auto column(std::uint64_t at, std::uint64_t count, std::uint64_t i) const {
+			if constexpr (std::is_same_v<T, std::string>) {
+				const auto first = load<std::uint64_t>(at + i * sizeof(std::uint64_t));
+				const auto last = load<std::uint64_t>(at + (i + 1) * sizeof(std::uint64_t));
+				if (first > last or last > column_chars<T>(at, count)) {
+					invalid();
+				}
+				const auto chars = at + (count + 1) * sizeof(std::uint64_t);
+				return std::string_view(data_ + chars + first, static_cast<std::size_t>(last - first));
+			}
+			else {
+				static_cast<void>(count);
+				return load<T>(at + i * sizeof(T));
+			}
+		}
+		[[nodiscard]] auto find(const N& value) const -> std::optional<std::size_t> {
+			auto first = std::size_t{0};
+			auto last = node_count();
+			while (first < last) {
+				const auto middle = first + (last - first) / 2;
+				if (node(middle) < value) {
+					first = middle + 1;
+				}
+				else {
+					last = middle;
+				}
+			}
+			return first < node_count() and node(first) == value ? std::optional{first} : std::nullopt;
+		}
+		// Edges are ordered by target index, since node indices follow node order.
+		[[nodiscard]] auto first_edge_to(std::uint64_t first, std::uint64_t last, std::size_t to) const
+		    -> std::uint64_t {
+			while (first < last) {
+				const auto middle = first + (last - first) / 2;
+				if (target(middle) < to) {
+					first = middle + 1;
+				}
+				else {
+					last = middle;
+				}
+			}
+			return first;
+		}
+		// Edge positions of node i.
+		[[nodiscard]] auto edge_range(std::size_t i) const -> std::pair<std::uint64_t, std::uint64_t> {
+			const auto first = load<std::uint64_t>(offsets_ + i * sizeof(std::uint64_t));
+			const auto last = load<std::uint64_t>(offsets_ + (i + 1) * sizeof(std::uint64_t));
+			if (first > last or last > edge_count_) {
+				invalid();
+			}
+			return {first, last};
+		}
+		[[nodiscard]] auto target(std::uint64_t e) const -> std::size_t {
+			const auto res = load<std::uint32_t>(targets_ + e * sizeof(std::uint32_t));
+			if (res >= node_count_) {
+				invalid();
+			}
+			return res;
+		}
+		[[nodiscard]] auto is_weighted(std::uint64_t e) const -> bool {
+			return load<std::uint8_t>(weighted_ + e) != 0;
+		}
+		[[nodiscard]] auto weight(std::uint64_t e) const -> weight_ref {
+			return column<E>(weights_, edge_count_, e);
 		}
 	};
 } // namespace gdwg
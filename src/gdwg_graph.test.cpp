@@ -1,6 +1,9 @@
 #include "gdwg_graph.h"
 
 #include <catch2/catch.hpp>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
 
 TEST_CASE("gdwg::graph") {
 	SECTION("Constructors") {
@@ -846,4 +849,2113 @@ TEST_CASE("edge inheritance") {
 		CHECK(*edge_ptr == *we2);
 		CHECK(!(*edge_ptr == *we3));
 	}
-}
\ No newline at end of file
+}
+
+TEST_CASE("betweenness centrality") {
+	using graph = gdwg::graph<int, int>;
+	SECTION("path") {
+		auto g = graph{1, 2, 3};
+		g.insert_edge(1, 2);
+		g.insert_edge(2, 3);
+		const auto bc = gdwg::betweenness_centrality(g);
+		CHECK(bc.at(1) == 0.0);
+		CHECK(bc.at(2) == 1.0);
+		CHECK(bc.at(3) == 0.0);
+	}
+	SECTION("parallel edges count once") {
+		auto g = graph{1, 2, 3};
+		g.insert_edge(1, 2, 4);
+		g.insert_edge(1, 2, 7);
+		g.insert_edge(2, 3);
+		CHECK(gdwg::betweenness_centrality(g).at(2) == 1.0);
+	}
+	SECTION("weighted") {
+		auto g = graph{1, 2, 3};
+		g.insert_edge(1, 2, 1);
+		g.insert_edge(2, 3, 1);
+		g.insert_edge(1, 3, 5);
+		CHECK(gdwg::betweenness_centrality(g).at(2) == 0.0);
+		auto options = gdwg::betweenness_options{};
+		options.weighted = true;
+		CHECK(gdwg::betweenness_centrality(g, options).at(2) == 1.0);
+		g.erase_edge(1, 3, 5);
+		g.insert_edge(1, 3, 2);
+		CHECK(gdwg::betweenness_centrality(g, options).at(2) == 0.5);
+	}
+	SECTION("negative weights") {
+		auto g = graph{1, 2};
+		g.insert_edge(1, 2, -1);
+		auto options = gdwg::betweenness_options{};
+		options.weighted = true;
+		CHECK_THROWS_WITH(gdwg::betweenness_centrality(g, options),
+		                  "Cannot call gdwg::betweenness_centrality on a graph with negative edge weights");
+	}
+	SECTION("threads and sampling") {
+		auto g = graph{};
+		for (auto i = 0; i < 20; ++i) {
+			g.insert_node(i);
+		}
+		for (auto i = 0; i < 20; ++i) {
+			g.insert_edge(i, (i + 1) % 20);
+			g.insert_edge(i, (i + 7) % 20, 3);
+		}
+		auto options = gdwg::betweenness_options{};
+		options.threads = 1;
+		const auto serial = gdwg::betweenness_centrality(g, options);
+		options.threads = 4;
+		const auto parallel = gdwg::betweenness_centrality(g, options);
+		for (const auto& [node, value] : serial) {
+			CHECK(parallel.at(node) == Approx(value));
+		}
+		options.samples = 20;
+		CHECK(gdwg::betweenness_centrality(g, options).at(3) == Approx(serial.at(3)));
+		options.samples = 5;
+		const auto estimate = gdwg::betweenness_centrality(g, options);
+		const auto again = gdwg::betweenness_centrality(g, options);
+		CHECK(estimate.size() == 20);
+		for (const auto& [node, value] : estimate) {
+			CHECK(again.at(node) == Approx(value));
+		}
+	}
+}
+TEST_CASE("community detection") {
+	using graph = gdwg::graph<int, int>;
+	// Two triangles joined by a single light edge.
+	auto g = graph{1, 2, 3, 4, 5, 6};
+	for (const auto& [from, to] : std::vector<std::pair<int, int>>{{1, 2}, {2, 3}, {3, 1}, {4, 5}, {5, 6}, {6, 4}}) {
+		g.insert_edge(from, to, 5);
+	}
+	g.insert_edge(3, 4, 1);
+	SECTION("label propagation") {
+		const auto communities = gdwg::label_propagation(g);
+		CHECK(communities.size() == 6);
+		CHECK(communities.at(1) == communities.at(2));
+		CHECK(communities.at(2) == communities.at(3));
+		CHECK(communities.at(4) == communities.at(5));
+		CHECK(communities.at(5) == communities.at(6));
+		CHECK(communities.at(1) != communities.at(4));
+	}
+	SECTION("louvain") {
+		auto options = gdwg::louvain_options{};
+		options.threads = 4;
+		const auto result = gdwg::louvain(g, options);
+		const auto expected = std::map<int, std::size_t>{{1, 0}, {2, 0}, {3, 0}, {4, 1}, {5, 1}, {6, 1}};
+		CHECK(result.communities == expected);
+		// Q = 2 * (15 / 31 - (31 / 62)^2)
+		CHECK(result.modularity == Approx(30.0 / 31.0 - 0.5));
+	}
+	SECTION("community graph") {
+		const auto communities = gdwg::louvain(g).communities;
+		const auto quotient = gdwg::community_graph(g, communities);
+		CHECK(quotient.nodes() == std::vector<std::size_t>{0, 1});
+		CHECK(quotient.find(0, 0, 15) != quotient.end());
+		CHECK(quotient.find(1, 1, 15) != quotient.end());
+		CHECK(quotient.find(0, 1, 1) != quotient.end());
+		CHECK(not quotient.is_connected(1, 0));
+		CHECK_THROWS_WITH(gdwg::community_graph(g, std::map<int, std::size_t>{{1, 0}}),
+		                  "Cannot call gdwg::community_graph without a community for every node");
+	}
+	SECTION("empty") {
+		CHECK(gdwg::louvain(graph{}).communities.empty());
+		CHECK(gdwg::label_propagation(graph{1}).at(1) == 0);
+	}
+}
+TEST_CASE("reachability index") {
+	using graph = gdwg::graph<int, int>;
+	SECTION("simple") {
+		auto g = graph{1, 2, 3, 4, 5};
+		g.insert_edge(1, 2);
+		g.insert_edge(2, 3, 4);
+		g.insert_edge(3, 2);
+		g.insert_edge(4, 3);
+		const auto index = gdwg::reachability_index(g);
+		CHECK(index.reaches(1, 3));
+		CHECK(index.reaches(3, 2));
+		CHECK(index.reaches(4, 2));
+		CHECK(index.reaches(5, 5));
+		CHECK(not index.reaches(3, 1));
+		CHECK(not index.reaches(1, 4));
+		CHECK(not index.reaches(1, 5));
+		CHECK_THROWS_WITH(index.reaches(1, 6),
+		                  "Cannot call gdwg::reachability_index<N>::reaches if src or dst node don't exist in the "
+		                  "graph");
+	}
+	SECTION("matches a full search") {
+		auto g = graph{};
+		auto rng = std::mt19937{7};
+		auto pick = std::uniform_int_distribution<int>{0, 59};
+		for (auto i = 0; i < 60; ++i) {
+			g.insert_node(i);
+		}
+		for (auto i = 0; i < 90; ++i) {
+			g.insert_edge(pick(rng), pick(rng));
+		}
+		const auto index = gdwg::reachability_index(g, 3, 11);
+		for (auto src = 0; src < 60; ++src) {
+			auto seen = std::set<int>{src};
+			auto stack = std::vector<int>{src};
+			while (not stack.empty()) {
+				const auto node = stack.back();
+				stack.pop_back();
+				for (const auto next : g.connections(node)) {
+					if (seen.insert(next).second) {
+						stack.push_back(next);
+					}
+				}
+			}
+			for (auto dst = 0; dst < 60; ++dst) {
+				CHECK(index.reaches(src, dst) == (seen.count(dst) != 0));
+			}
+		}
+	}
+}
+TEST_CASE("k shortest paths") {
+	using graph = gdwg::graph<std::string, int>;
+	auto g = graph{"C", "D", "E", "F", "G", "H"};
+	g.insert_edge("C", "D", 3);
+	g.insert_edge("C", "E", 2);
+	g.insert_edge("D", "F", 4);
+	g.insert_edge("E", "D", 1);
+	g.insert_edge("E", "F", 2);
+	g.insert_edge("E", "G", 3);
+	g.insert_edge("F", "G", 2);
+	g.insert_edge("F", "H", 1);
+	g.insert_edge("G", "H", 2);
+	auto options = gdwg::k_shortest_paths_options{};
+	options.weighted = true;
+	SECTION("weighted") {
+		options.threads = 3;
+		const auto paths = gdwg::k_shortest_paths(g, std::string{"C"}, std::string{"H"}, 3, options);
+		REQUIRE(paths.size() == 3);
+		CHECK(paths[0].nodes == std::vector<std::string>{"C", "E", "F", "H"});
+		CHECK(paths[0].cost == 5.0);
+		CHECK(paths[1].nodes == std::vector<std::string>{"C", "E", "G", "H"});
+		CHECK(paths[1].cost == 7.0);
+		CHECK(paths[2].nodes == std::vector<std::string>{"C", "D", "F", "H"});
+		CHECK(paths[2].cost == 8.0);
+	}
+	SECTION("fewer paths than asked for") {
+		const auto paths = gdwg::k_shortest_paths(g, std::string{"C"}, std::string{"H"}, 100, options);
+		CHECK(paths.size() == 7);
+		for (auto i = std::size_t{1}; i < paths.size(); ++i) {
+			CHECK(paths[i - 1].cost <= paths[i].cost);
+		}
+		CHECK(gdwg::k_shortest_paths(g, std::string{"H"}, std::string{"C"}, 3, options).empty());
+		CHECK(gdwg::k_shortest_paths(g, std::string{"C"}, std::string{"H"}, 0, options).empty());
+	}
+	SECTION("unweighted") {
+		const auto paths = gdwg::k_shortest_paths(g, std::string{"C"}, std::string{"H"}, 2);
+		REQUIRE(paths.size() == 2);
+		CHECK(paths[0].nodes == std::vector<std::string>{"C", "D", "F", "H"});
+		CHECK(paths[1].nodes == std::vector<std::string>{"C", "E", "F", "H"});
+		CHECK(paths[1].cost == 3.0);
+	}
+	SECTION("dne") {
+		CHECK_THROWS_WITH(gdwg::k_shortest_paths(g, std::string{"C"}, std::string{"Z"}, 1),
+		                  "Cannot call gdwg::k_shortest_paths if src or dst node don't exist in the graph");
+	}
+}
+TEST_CASE("random walks") {
+	using graph = gdwg::graph<int, int>;
+	auto g = graph{1, 2, 3, 4};
+	g.insert_edge(1, 2, 1);
+	g.insert_edge(1, 3, 3);
+	g.insert_edge(2, 1, 1);
+	g.insert_edge(3, 1, 1);
+	g.insert_edge(3, 4, 1);
+	auto options = gdwg::random_walk_options{};
+	options.length = 5;
+	SECTION("walks follow edges") {
+		const auto walker = gdwg::random_walker(g);
+		const auto walks = walker.walks({1, 2, 3, 4}, options);
+		REQUIRE(walks.size() == 4);
+		for (const auto& walk : walks) {
+			CHECK(not walk.empty());
+			for (auto i = std::size_t{1}; i < walk.size(); ++i) {
+				CHECK(g.is_connected(walk[i - 1], walk[i]));
+			}
+		}
+		CHECK(walks[3] == std::vector<int>{4});
+	}
+	SECTION("deterministic across thread counts") {
+		const auto walker = gdwg::random_walker(g, true);
+		const auto starts = std::vector<int>(64, 1);
+		options.threads = 1;
+		const auto serial = walker.walks(starts, options);
+		options.threads = 4;
+		CHECK(walker.walks(starts, options) == serial);
+	}
+	SECTION("weighted transitions") {
+		const auto walker = gdwg::random_walker(g, true);
+		options.length = 2;
+		const auto walks = walker.walks(std::vector<int>(4000, 1), options);
+		const auto to_three = std::count_if(walks.begin(), walks.end(), [](const auto& walk) { return walk[1] == 3; });
+		CHECK(static_cast<double>(to_three) / 4000.0 == Approx(0.75).margin(0.05));
+	}
+	SECTION("node2vec bias") {
+		const auto walker = gdwg::random_walker(g);
+		options.length = 3;
+		options.p = 1e6;
+		// Returning from 3 straight back to 1 is all but forbidden, so walks 1 -> 3 continue to 4.
+		for (const auto& walk : walker.walks(std::vector<int>(200, 1), options)) {
+			if (walk[1] == 3) {
+				CHECK(walk[2] == 4);
+			}
+		}
+		options.p = 0.0;
+		CHECK_THROWS_WITH(walker.walks({1}, options),
+		                  "Cannot call gdwg::random_walker<N>::walks unless p and q are positive");
+	}
+	SECTION("dne") {
+		CHECK_THROWS_WITH(gdwg::random_walker(g).walks({9}),
+		                  "Cannot call gdwg::random_walker<N>::walks from a node that doesn't exist in the graph");
+	}
+}
+TEST_CASE("subgraph extraction") {
+	using graph = gdwg::graph<int, int>;
+	auto g = graph{1, 2, 3, 4, 5};
+	g.insert_edge(1, 2, 3);
+	g.insert_edge(1, 2);
+	g.insert_edge(2, 3, 1);
+	g.insert_edge(3, 1, 2);
+	g.insert_edge(3, 4, 7);
+	g.insert_edge(4, 5);
+	SECTION("induced subgraph") {
+		const auto sub = g.induced_subgraph(std::vector<int>{3, 1, 2, 1});
+		auto expected = graph{1, 2, 3};
+		expected.insert_edge(1, 2, 3);
+		expected.insert_edge(1, 2);
+		expected.insert_edge(2, 3, 1);
+		expected.insert_edge(3, 1, 2);
+		CHECK(sub == expected);
+		CHECK(g.induced_subgraph({5}) == graph{5});
+		CHECK(g.induced_subgraph(std::vector<int>{}).empty());
+		CHECK_THROWS_WITH(g.induced_subgraph({1, 6}),
+		                  "Cannot call gdwg::graph<N, E>::induced_subgraph on a node that doesn't exist in the graph");
+	}
+	SECTION("k hop subgraph") {
+		CHECK(g.k_hop_subgraph(2, 0) == graph{2});
+		const auto two_hops = g.k_hop_subgraph(2, 2);
+		CHECK(two_hops.nodes() == std::vector<int>{1, 2, 3, 4});
+		CHECK(two_hops.is_connected(3, 4));
+		CHECK(two_hops.is_connected(1, 2));
+		CHECK(g.k_hop_subgraph(1, 10) == g);
+		CHECK_THROWS_WITH(g.k_hop_subgraph(6, 1),
+		                  "Cannot call gdwg::graph<N, E>::k_hop_subgraph if seed doesn't exist in the graph");
+	}
+	SECTION("subgraphs are independent copies") {
+		auto sub = g.induced_subgraph({1, 2});
+		sub.replace_node(1, 10);
+		CHECK(g.is_node(1));
+		CHECK(sub.is_connected(10, 2));
+	}
+}
+TEST_CASE("colouring and independent sets") {
+	using graph = gdwg::graph<int, int>;
+	auto g = graph{};
+	auto rng = std::mt19937{3};
+	auto pick = std::uniform_int_distribution<int>{0, 2999};
+	for (auto i = 0; i < 3000; ++i) {
+		g.insert_node(i);
+	}
+	for (auto i = 0; i < 12000; ++i) {
+		g.insert_edge(pick(rng), pick(rng));
+	}
+	auto conflicts = [&](auto same) {
+		auto count = 0;
+		for (const auto& [from, to, weight] : g) {
+			if (from != to and same(from, to)) {
+				++count;
+			}
+		}
+		return count;
+	};
+	SECTION("colouring") {
+		for (const auto order : {gdwg::colouring_order::random, gdwg::colouring_order::smallest_last}) {
+			auto options = gdwg::colouring_options{};
+			options.order = order;
+			options.threads = 4;
+			const auto colours = gdwg::greedy_colouring(g, options);
+			CHECK(colours.size() == 3000);
+			CHECK(conflicts([&](int from, int to) { return colours.at(from) == colours.at(to); }) == 0);
+			options.threads = 1;
+			CHECK(gdwg::greedy_colouring(g, options) == colours);
+		}
+	}
+	SECTION("smallest last colours a tree with two colours") {
+		auto tree = graph{1, 2, 3, 4, 5};
+		tree.insert_edge(1, 2);
+		tree.insert_edge(1, 3);
+		tree.insert_edge(3, 4);
+		tree.insert_edge(5, 3);
+		auto options = gdwg::colouring_options{};
+		options.order = gdwg::colouring_order::smallest_last;
+		const auto colours = gdwg::greedy_colouring(tree, options);
+		CHECK(std::all_of(colours.begin(), colours.end(), [](const auto& entry) { return entry.second < 2; }));
+	}
+	SECTION("maximal independent set") {
+		auto options = gdwg::independent_set_options{};
+		options.threads = 4;
+		const auto in_set = gdwg::maximal_independent_set(g, options);
+		CHECK(conflicts([&](int from, int to) { return in_set.at(from) and in_set.at(to); }) == 0);
+		// Maximal: every node outside the set has a neighbour inside it.
+		auto covered = std::set<int>{};
+		for (const auto& [from, to, weight] : g) {
+			if (in_set.at(from)) {
+				covered.insert(to);
+			}
+			if (in_set.at(to)) {
+				covered.insert(from);
+			}
+		}
+		for (const auto& [node, member] : in_set) {
+			CHECK((member or covered.count(node) != 0));
+		}
+		options.threads = 1;
+		CHECK(gdwg::maximal_independent_set(g, options) == in_set);
+	}
+}
+TEST_CASE("multi-source bfs") {
+	using graph = gdwg::graph<int, int>;
+	auto g = graph{};
+	auto rng = std::mt19937{5};
+	auto pick = std::uniform_int_distribution<int>{0, 299};
+	for (auto i = 0; i < 300; ++i) {
+		g.insert_node(i);
+	}
+	for (auto i = 0; i < 600; ++i) {
+		g.insert_edge(pick(rng), pick(rng));
+	}
+	auto sources = std::vector<int>(300);
+	std::iota(sources.begin(), sources.end(), 0);
+	auto expected = std::map<int, std::map<int, std::size_t>>{};
+	for (const auto source : sources) {
+		auto& row = expected[source];
+		row[source] = 0;
+		auto frontier = std::vector<int>{source};
+		for (auto hops = std::size_t{1}; not frontier.empty(); ++hops) {
+			auto next = std::vector<int>{};
+			for (const auto node : frontier) {
+				for (const auto to : g.connections(node)) {
+					if (row.emplace(to, hops).second) {
+						next.push_back(to);
+					}
+				}
+			}
+			frontier = std::move(next);
+		}
+	}
+	SECTION("hop counts") {
+		auto options = gdwg::multi_source_bfs_options{};
+		CHECK(gdwg::hop_counts(g, sources, options) == expected);
+		options.batch = 256;
+		options.threads = 3;
+		CHECK(gdwg::hop_counts(g, sources, options) == expected);
+	}
+	SECTION("callback") {
+		auto visits = std::size_t{0};
+		auto hops_to_self = std::size_t{0};
+		gdwg::multi_source_bfs(g, std::vector<int>{7, 7}, [&](int source, int node, std::size_t hops) {
+			++visits;
+			CHECK(expected.at(source).at(node) == hops);
+			hops_to_self += node == source ? 1 : 0;
+		});
+		CHECK(visits == 2 * expected.at(7).size());
+		CHECK(hops_to_self == 2);
+	}
+	SECTION("errors") {
+		auto options = gdwg::multi_source_bfs_options{};
+		options.batch = 32;
+		CHECK_THROWS_WITH(gdwg::hop_counts(g, sources, options),
+		                  "Cannot call gdwg::multi_source_bfs with a batch other than 64 or 256");
+		CHECK_THROWS_WITH(gdwg::hop_counts(g, {1000}),
+		                  "Cannot call gdwg::multi_source_bfs from a node that doesn't exist in the graph");
+	}
+}
+TEST_CASE("minimum cut") {
+	using graph = gdwg::graph<int, int>;
+	// The example from Stoer and Wagner's paper.
+	auto g = graph{1, 2, 3, 4, 5, 6, 7, 8};
+	const auto edges = std::vector<std::tuple<int, int, int>>{
+	    {1, 2, 2},
+	    {1, 5, 3},
+	    {2, 3, 3},
+	    {2, 5, 2},
+	    {2, 6, 2},
+	    {3, 4, 4},
+	    {3, 7, 2},
+	    {4, 7, 2},
+	    {4, 8, 2},
+	    {5, 6, 3},
+	    {6, 7, 1},
+	    {7, 8, 3},
+	};
+	for (const auto& [from, to, weight] : edges) {
+		g.insert_edge(from, to, weight);
+	}
+	const auto left = std::set<int>{1, 2, 5, 6};
+	const auto right = std::set<int>{3, 4, 7, 8};
+	auto same_partition = [&](const auto& cut) {
+		return (cut.first == left and cut.second == right) or (cut.first == right and cut.second == left);
+	};
+	SECTION("stoer wagner") {
+		const auto cut = gdwg::stoer_wagner_min_cut(g);
+		CHECK(cut.weight == 4.0);
+		CHECK(same_partition(cut));
+	}
+	SECTION("karger stein") {
+		auto options = gdwg::karger_stein_options{};
+		options.threads = 4;
+		const auto cut = gdwg::karger_stein_min_cut(g, options);
+		CHECK(cut.weight == 4.0);
+		CHECK(same_partition(cut));
+	}
+	SECTION("both directions add up") {
+		g.insert_edge(7, 6, 2);
+		CHECK(gdwg::stoer_wagner_min_cut(g).weight == 5.0);
+	}
+	SECTION("agree on a larger graph") {
+		auto big = graph{};
+		auto rng = std::mt19937{9};
+		auto pick = std::uniform_int_distribution<int>{0, 39};
+		auto weight = std::uniform_int_distribution<int>{1, 5};
+		for (auto i = 0; i < 40; ++i) {
+			big.insert_node(i);
+		}
+		for (auto i = 0; i < 200; ++i) {
+			big.insert_edge(pick(rng), pick(rng), weight(rng));
+		}
+		const auto exact = gdwg::stoer_wagner_min_cut(big);
+		CHECK(exact.first.size() + exact.second.size() == 40);
+		auto options = gdwg::karger_stein_options{};
+		options.trials = 8;
+		CHECK(gdwg::karger_stein_min_cut(big, options).weight == exact.weight);
+	}
+	SECTION("disconnected") {
+		auto split = graph{1, 2, 3};
+		split.insert_edge(1, 2, 7);
+		const auto cut = gdwg::stoer_wagner_min_cut(split);
+		CHECK(cut.weight == 0.0);
+		CHECK((cut.first == std::set<int>{3} or cut.second == std::set<int>{3}));
+		CHECK(gdwg::karger_stein_min_cut(split).weight == 0.0);
+	}
+	SECTION("errors") {
+		CHECK_THROWS_WITH(gdwg::stoer_wagner_min_cut(graph{1}),
+		                  "Cannot call gdwg::stoer_wagner_min_cut on a graph with fewer than two nodes");
+		auto negative = graph{1, 2};
+		negative.insert_edge(1, 2, -3);
+		CHECK_THROWS_WITH(gdwg::karger_stein_min_cut(negative),
+		                  "Cannot call gdwg::karger_stein_min_cut on a graph with negative edge weights");
+	}
+}
+TEST_CASE("bipartite matching") {
+	using graph = gdwg::graph<std::string, int>;
+	SECTION("hopcroft karp") {
+		auto g = graph{"a", "b", "c", "x", "y", "z"};
+		g.insert_edge("a", "x");
+		g.insert_edge("a", "y");
+		g.insert_edge("b", "x");
+		g.insert_edge("z", "c");
+		g.insert_edge("c", "x");
+		g.insert_edge("a", "b");
+		const auto matching = gdwg::maximum_bipartite_matching(g, std::vector<std::string>{"a", "b", "c"});
+		CHECK(matching.size() == 3);
+		CHECK(matching.at("a") == "y");
+		CHECK(matching.at("b") == "x");
+		CHECK(matching.at("c") == "z");
+		CHECK_THROWS_WITH(gdwg::maximum_bipartite_matching(g, std::vector<std::string>{"q"}),
+		                  "Cannot call gdwg::maximum_bipartite_matching with a node that doesn't exist in the graph");
+	}
+	SECTION("hopcroft karp on a larger graph") {
+		auto g = gdwg::graph<int, int>{};
+		for (auto i = 0; i < 200; ++i) {
+			g.insert_node(i);
+		}
+		// Left node i links to right nodes 100 + i and 100 + (i + 1) % 100: a perfect matching exists.
+		auto left = std::vector<int>{};
+		for (auto i = 0; i < 100; ++i) {
+			left.push_back(i);
+			g.insert_edge(i, 100 + (i + 1) % 100);
+			g.insert_edge(i, 100 + i);
+		}
+		const auto matching = gdwg::maximum_bipartite_matching(g, left);
+		CHECK(matching.size() == 100);
+		auto right = std::set<int>{};
+		for (const auto& [from, to] : matching) {
+			CHECK(g.is_connected(from, to));
+			right.insert(to);
+		}
+		CHECK(right.size() == 100);
+	}
+	SECTION("hopcroft karp matches simple augmenting paths on random graphs") {
+		auto rng = std::mt19937{35};
+		for (auto round = 0; round < 20; ++round) {
+			auto g = gdwg::graph<int, int>{};
+			for (auto i = 0; i < 60; ++i) {
+				g.insert_node(i);
+			}
+			auto left = std::vector<int>{};
+			for (auto i = 0; i < 30; ++i) {
+				left.push_back(i);
+				for (auto k = rng() % 4; k > 0; --k) {
+					g.insert_edge(i, 30 + static_cast<int>(rng() % 30));
+				}
+			}
+			// Kuhn's algorithm: one augmenting path search per left node.
+			auto partner = std::vector<int>(60, -1);
+			auto seen = std::vector<bool>{};
+			const auto augment = [&](const auto& self, int u) -> bool {
+				for (const auto v : g.connections(u)) {
+					if (not seen[static_cast<std::size_t>(v)]) {
+						seen[static_cast<std::size_t>(v)] = true;
+						if (partner[static_cast<std::size_t>(v)] == -1
+						    or self(self, partner[static_cast<std::size_t>(v)]))
+						{
+							partner[static_cast<std::size_t>(v)] = u;
+							return true;
+						}
+					}
+				}
+				return false;
+			};
+			auto expected = std::size_t{0};
+			for (const auto u : left) {
+				seen.assign(60, false);
+				if (augment(augment, u)) {
+					++expected;
+				}
+			}
+			const auto matching = gdwg::maximum_bipartite_matching(g, left);
+			CHECK(matching.size() == expected);
+			auto right = std::set<int>{};
+			for (const auto& [from, to] : matching) {
+				CHECK(g.is_connected(from, to));
+				right.insert(to);
+			}
+			CHECK(right.size() == matching.size());
+		}
+	}
+	SECTION("auction") {
+		auto g = gdwg::graph<int, int>{};
+		auto rng = std::mt19937{4};
+		auto weight = std::uniform_int_distribution<int>{-3, 20};
+		for (auto i = 0; i < 12; ++i) {
+			g.insert_node(i);
+		}
+		auto benefit = std::vector<std::vector<int>>(6, std::vector<int>(6, 0));
+		for (auto i = 0; i < 6; ++i) {
+			for (auto j = 0; j < 6; ++j) {
+				if ((i + j) % 3 != 0) {
+					benefit[static_cast<std::size_t>(i)][static_cast<std::size_t>(j)] = weight(rng);
+					g.insert_edge(i, 6 + j, benefit[static_cast<std::size_t>(i)][static_cast<std::size_t>(j)]);
+				}
+			}
+		}
+		// Brute force over all assignments, where a non-positive pair is as good as leaving both unmatched.
+		auto permutation = std::vector<std::size_t>{0, 1, 2, 3, 4, 5};
+		auto best = 0;
+		do {
+			auto total = 0;
+			for (auto i = std::size_t{0}; i < 6; ++i) {
+				total += std::max(0, benefit[i][permutation[i]]);
+			}
+			best = std::max(best, total);
+		} while (std::next_permutation(permutation.begin(), permutation.end()));
+		auto options = gdwg::auction_options{};
+		options.threads = 3;
+		const auto matching = gdwg::maximum_weight_matching(g, std::vector<int>{0, 1, 2, 3, 4, 5}, options);
+		auto total = 0;
+		auto right = std::set<int>{};
+		for (const auto& [from, to] : matching) {
+			total += benefit[static_cast<std::size_t>(from)][static_cast<std::size_t>(to - 6)];
+			right.insert(to);
+		}
+		CHECK(right.size() == matching.size());
+		CHECK(total == best);
+	}
+}
+TEST_CASE("eulerian trails and cycles") {
+	using graph = gdwg::graph<int, int>;
+	SECTION("eulerian circuit") {
+		auto g = graph{1, 2, 3};
+		g.insert_edge(1, 2);
+		g.insert_edge(2, 3, 1);
+		g.insert_edge(2, 3, 2);
+		g.insert_edge(3, 2);
+		g.insert_edge(3, 1);
+		CHECK(gdwg::eulerian_kind(g) == gdwg::eulerian::circuit);
+		const auto trail = gdwg::eulerian_path(g);
+		REQUIRE(trail.has_value());
+		CHECK(*trail == std::vector<int>{1, 2, 3, 2, 3, 1});
+	}
+	SECTION("eulerian path") {
+		auto g = graph{1, 2, 3, 4};
+		g.insert_edge(2, 1);
+		g.insert_edge(1, 3);
+		g.insert_edge(3, 2);
+		g.insert_edge(2, 4);
+		CHECK(gdwg::eulerian_kind(g) == gdwg::eulerian::path);
+		CHECK(gdwg::eulerian_path(g) == std::vector<int>{2, 1, 3, 2, 4});
+	}
+	SECTION("none") {
+		auto g = graph{1, 2, 3, 4};
+		g.insert_edge(1, 2);
+		g.insert_edge(2, 1);
+		g.insert_edge(3, 4);
+		g.insert_edge(4, 3);
+		CHECK(gdwg::eulerian_kind(g) == gdwg::eulerian::none);
+		CHECK(not gdwg::eulerian_path(g).has_value());
+		CHECK(gdwg::eulerian_path(graph{1}) == std::vector<int>{});
+	}
+	auto g = graph{1, 2, 3, 4};
+	g.insert_edge(1, 1);
+	g.insert_edge(1, 2);
+	g.insert_edge(2, 1, 3);
+	g.insert_edge(2, 1, 4);
+	g.insert_edge(2, 3);
+	g.insert_edge(3, 1);
+	g.insert_edge(3, 4);
+	g.insert_edge(4, 2);
+	SECTION("all cycles") {
+		auto cycles = std::set<std::vector<int>>{};
+		const auto count = gdwg::for_each_cycle(g, [&](const std::vector<int>& cycle) { cycles.insert(cycle); });
+		CHECK(count == 4);
+		CHECK(cycles == std::set<std::vector<int>>{{1}, {1, 2}, {1, 2, 3}, {2, 3, 4}});
+	}
+	SECTION("bounded") {
+		auto cycles = std::vector<std::vector<int>>{};
+		auto options = gdwg::cycle_options{};
+		options.max_length = 2;
+		gdwg::for_each_cycle(g, [&](const std::vector<int>& cycle) { cycles.push_back(cycle); }, options);
+		CHECK(cycles == std::vector<std::vector<int>>{{1}, {1, 2}});
+		options.max_length = 0;
+		options.max_cycles = 3;
+		CHECK(gdwg::for_each_cycle(g, [](const std::vector<int>&) {}, options) == 3);
+		CHECK(gdwg::for_each_cycle(g, [](const std::vector<int>&) { return false; }) == 1);
+	}
+	SECTION("bounded matches filtered unbounded") {
+		auto dense = graph{};
+		auto rng = std::mt19937{2};
+		auto pick = std::uniform_int_distribution<int>{0, 9};
+		for (auto i = 0; i < 10; ++i) {
+			dense.insert_node(i);
+		}
+		for (auto i = 0; i < 30; ++i) {
+			dense.insert_edge(pick(rng), pick(rng));
+		}
+		auto all = std::set<std::vector<int>>{};
+		gdwg::for_each_cycle(dense, [&](const std::vector<int>& cycle) { all.insert(cycle); });
+		for (auto length = std::size_t{1}; length <= 5; ++length) {
+			auto bounded = std::set<std::vector<int>>{};
+			auto options = gdwg::cycle_options{};
+			options.max_length = length;
+			gdwg::for_each_cycle(dense, [&](const std::vector<int>& cycle) { bounded.insert(cycle); }, options);
+			auto expected = std::set<std::vector<int>>{};
+			std::copy_if(all.begin(), all.end(), std::inserter(expected, expected.end()), [&](const auto& cycle) {
+				return cycle.size() <= length;
+			});
+			CHECK(bounded == expected);
+		}
+	}
+}
+
+TEST_CASE("dominator trees") {
+	using graph = gdwg::graph<std::string, int>;
+	auto g = graph{"entry", "a", "b", "c", "d", "exit", "dead"};
+	g.insert_edge("entry", "a", 1);
+	g.insert_edge("a", "b", 1);
+	g.insert_edge("a", "c", 1);
+	g.insert_edge("b", "d", 1);
+	g.insert_edge("c", "d", 1);
+	g.insert_edge("d", "a", 1);
+	g.insert_edge("d", "exit", 1);
+	g.insert_edge("dead", "exit", 1);
+
+	SECTION("dominators") {
+		const auto tree = gdwg::dominator_tree<std::string>(g, "entry");
+		CHECK(tree.root() == "entry");
+		CHECK(tree.immediate_dominator("entry") == std::nullopt);
+		CHECK(tree.immediate_dominator("a") == "entry");
+		CHECK(tree.immediate_dominator("b") == "a");
+		CHECK(tree.immediate_dominator("c") == "a");
+		CHECK(tree.immediate_dominator("d") == "a");
+		CHECK(tree.immediate_dominator("exit") == "d");
+		CHECK(tree.immediate_dominator("dead") == std::nullopt);
+		CHECK(not tree.reachable("dead"));
+		CHECK(tree.dominates("a", "exit"));
+		CHECK(tree.dominates("d", "d"));
+		CHECK(not tree.dominates("b", "d"));
+		CHECK(not tree.dominates("entry", "dead"));
+		const auto& nodes = tree.nodes();
+		const auto at = [&](const std::string& node) {
+			return static_cast<std::size_t>(std::find(nodes.begin(), nodes.end(), node) - nodes.begin());
+		};
+		CHECK(tree.parents()[at("entry")] == at("entry"));
+		CHECK(tree.parents()[at("dead")] == gdwg::dominator_tree<std::string>::npos);
+	}
+
+	SECTION("post-dominators") {
+		const auto tree = gdwg::dominator_tree<std::string>(g, "exit", gdwg::dominance::post_dominators);
+		CHECK(tree.immediate_dominator("d") == "exit");
+		CHECK(tree.immediate_dominator("b") == "d");
+		CHECK(tree.immediate_dominator("a") == "d");
+		CHECK(tree.immediate_dominator("entry") == "a");
+		CHECK(tree.immediate_dominator("dead") == "exit");
+		CHECK(tree.dominates("d", "entry"));
+		CHECK(not tree.dominates("b", "a"));
+	}
+
+	SECTION("matches removal definition") {
+		auto rng = std::mt19937{5};
+		for (auto round = 0; round < 20; ++round) {
+			auto random = gdwg::graph<int, int>{};
+			auto pick = std::uniform_int_distribution<int>{0, 11};
+			for (auto i = 0; i < 12; ++i) {
+				random.insert_node(i);
+			}
+			for (auto i = 0; i < 24; ++i) {
+				random.insert_edge(pick(rng), pick(rng), 1);
+			}
+			const auto tree = gdwg::dominator_tree<int>(random, 0);
+			// b is reachable from 0 without passing through banned.
+			const auto reaches = [&](int banned, int b) {
+				auto seen = std::set<int>{0};
+				auto stack = std::vector<int>{0};
+				while (not stack.empty()) {
+					const auto u = stack.back();
+					stack.pop_back();
+					for (const auto v : random.connections(u)) {
+						if (v != banned and seen.insert(v).second) {
+							stack.push_back(v);
+						}
+					}
+				}
+				return seen.contains(b);
+			};
+			for (auto a = 0; a < 12; ++a) {
+				for (auto b = 0; b < 12; ++b) {
+					const auto reachable = reaches(-1, b);
+					CHECK(tree.reachable(b) == reachable);
+					const auto expected = reachable and (a == b or a == 0 or (reaches(-1, a) and not reaches(a, b)));
+					CHECK(tree.dominates(a, b) == expected);
+				}
+			}
+		}
+	}
+
+	SECTION("missing node") {
+		CHECK_THROWS_MATCHES(gdwg::dominator_tree<std::string>(g, "nope"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::dominator_tree<N>::dominator_tree if root "
+		                                              "node doesn't exist in the graph"));
+		const auto tree = gdwg::dominator_tree<std::string>(g, "entry");
+		CHECK_THROWS_MATCHES(tree.dominates("entry", "nope"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::dominator_tree<N>::dominates if node doesn't "
+		                                              "exist in the graph"));
+	}
+}
+
+TEST_CASE("diameter and eccentricity") {
+	using graph = gdwg::graph<int, int>;
+	// Exact eccentricities by running Floyd-Warshall over the undirected view.
+	const auto exact = [](const graph& g, bool weighted) {
+		const auto nodes = g.nodes();
+		const auto n = nodes.size();
+		const auto infinity = std::numeric_limits<double>::infinity();
+		auto dist = std::vector<std::vector<double>>(n, std::vector<double>(n, infinity));
+		for (auto i = std::size_t{0}; i < n; ++i) {
+			dist[i][i] = 0.0;
+		}
+		for (const auto& [src, dst, weight] : g) {
+			const auto i = static_cast<std::size_t>(std::find(nodes.begin(), nodes.end(), src) - nodes.begin());
+			const auto j = static_cast<std::size_t>(std::find(nodes.begin(), nodes.end(), dst) - nodes.begin());
+			if (i != j) {
+				const auto cost = weighted ? static_cast<double>(*weight) : 1.0;
+				dist[i][j] = std::min(dist[i][j], cost);
+				dist[j][i] = dist[i][j];
+			}
+		}
+		for (auto k = std::size_t{0}; k < n; ++k) {
+			for (auto i = std::size_t{0}; i < n; ++i) {
+				for (auto j = std::size_t{0}; j < n; ++j) {
+					dist[i][j] = std::min(dist[i][j], dist[i][k] + dist[k][j]);
+				}
+			}
+		}
+		auto res = std::map<int, double>{};
+		for (auto i = std::size_t{0}; i < n; ++i) {
+			auto eccentricity = 0.0;
+			for (const auto d : dist[i]) {
+				if (d != infinity) {
+					eccentricity = std::max(eccentricity, d);
+				}
+			}
+			res.emplace(nodes[i], eccentricity);
+		}
+		return res;
+	};
+
+	SECTION("path and cycle") {
+		auto path = graph{1, 2, 3, 4, 5};
+		for (auto i = 1; i < 5; ++i) {
+			path.insert_edge(i, i + 1, 10);
+		}
+		CHECK(gdwg::diameter(path) == 4.0);
+		CHECK(gdwg::diameter(path, {.weighted = true, .threads = 1}) == 40.0);
+		path.insert_edge(5, 1, 1);
+		CHECK(gdwg::diameter(path) == 2.0);
+		CHECK(gdwg::diameter(path, {.weighted = true, .threads = 1}) == 20.0);
+		CHECK(gdwg::diameter(graph{}) == 0.0);
+		CHECK(gdwg::diameter(graph{1, 2}) == 0.0);
+	}
+
+	SECTION("matches all pairs") {
+		auto rng = std::mt19937{8};
+		for (auto round = 0; round < 30; ++round) {
+			auto g = graph{};
+			auto pick = std::uniform_int_distribution<int>{0, 24};
+			auto weight = std::uniform_int_distribution<int>{1, 9};
+			for (auto i = 0; i < 25; ++i) {
+				g.insert_node(i);
+			}
+			for (auto i = 0; i < 20 + round; ++i) {
+				g.insert_edge(pick(rng), pick(rng), weight(rng));
+			}
+			for (const auto weighted : {false, true}) {
+				const auto expected = exact(g, weighted);
+				auto largest = 0.0;
+				for (const auto& [node, eccentricity] : expected) {
+					largest = std::max(largest, eccentricity);
+				}
+				for (const auto threads : {std::size_t{1}, std::size_t{3}}) {
+					CHECK(gdwg::diameter(g, {.weighted = weighted, .threads = threads}) == largest);
+					const auto approximate = gdwg::eccentricities(g, {.weighted = weighted, .threads = threads});
+					for (const auto& [node, eccentricity] : approximate) {
+						CHECK(eccentricity <= expected.at(node));
+					}
+					const auto full = gdwg::eccentricities(g, {.weighted = weighted, .rounds = 25, .threads = threads});
+					CHECK(full == expected);
+				}
+			}
+		}
+	}
+
+	SECTION("errors") {
+		auto g = graph{1, 2};
+		g.insert_edge(1, 2, -1);
+		CHECK_THROWS_MATCHES(gdwg::diameter(g, {.weighted = true}),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::diameter on a graph with negative edge "
+		                                              "weights"));
+		auto strings = gdwg::graph<int, std::string>{1, 2};
+		CHECK_THROWS_MATCHES(gdwg::eccentricities(strings, {.weighted = true}),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::eccentricities with weighted set if E is "
+		                                              "not arithmetic"));
+	}
+}
+
+TEST_CASE("personalised pagerank") {
+	using graph = gdwg::graph<int, int>;
+	// Power iteration for x = alpha * s + (1 - alpha) * x P, with dangling mass returned to the seeds.
+	const auto power = [](const graph& g, const std::vector<int>& seeds, double alpha, bool weighted) {
+		const auto nodes = g.nodes();
+		auto teleport = std::map<int, double>{};
+		for (const auto seed : seeds) {
+			teleport[seed] += 1.0 / static_cast<double>(seeds.size());
+		}
+		auto x = teleport;
+		for (auto iteration = 0; iteration < 500; ++iteration) {
+			auto next = std::map<int, double>{};
+			for (const auto& [node, share] : teleport) {
+				next[node] += alpha * share;
+			}
+			for (const auto node : nodes) {
+				const auto mass = (1.0 - alpha) * x[node];
+				const auto out = g.connections(node);
+				if (out.empty()) {
+					for (const auto& [seed, share] : teleport) {
+						next[seed] += mass * share;
+					}
+					continue;
+				}
+				auto total = 0.0;
+				for (const auto& [src, dst, weight] : g) {
+					total += src == node ? (weighted ? static_cast<double>(*weight) : 1.0) : 0.0;
+				}
+				for (const auto& [src, dst, weight] : g) {
+					if (src == node) {
+						next[dst] += mass * (weighted ? static_cast<double>(*weight) : 1.0) / total;
+					}
+				}
+			}
+			x = next;
+		}
+		return x;
+	};
+
+	auto g = graph{1, 2, 3, 4, 5, 6};
+	g.insert_edge(1, 2, 1);
+	g.insert_edge(1, 3, 3);
+	g.insert_edge(2, 3, 1);
+	g.insert_edge(3, 1, 2);
+	g.insert_edge(3, 4, 1);
+	g.insert_edge(4, 5, 5);
+	g.insert_edge(6, 1, 1);
+
+	SECTION("matches power iteration") {
+		for (const auto weighted : {false, true}) {
+			for (const auto& seeds : {std::vector<int>{1}, std::vector<int>{2, 4}}) {
+				const auto expected = power(g, seeds, 0.2, weighted);
+				auto options = gdwg::personalised_pagerank_options{.alpha = 0.2, .epsilon = 1e-9};
+				options.weighted = weighted;
+				const auto scores = gdwg::personalised_pagerank(g, seeds, options);
+				for (const auto& [node, score] : expected) {
+					CHECK(scores.contains(node) == (score > 0.0));
+					if (scores.contains(node)) {
+						CHECK(scores.at(node) == Approx(score).margin(1e-6));
+					}
+				}
+			}
+		}
+		CHECK_FALSE(gdwg::personalised_pagerank(g, 1).contains(6));
+	}
+
+	SECTION("stays local") {
+		auto chain = graph{};
+		for (auto i = 0; i < 2000; ++i) {
+			chain.insert_node(i);
+		}
+		for (auto i = 0; i + 1 < 2000; ++i) {
+			chain.insert_edge(i, i + 1, 1);
+		}
+		const auto scores = gdwg::personalised_pagerank(chain, 0, {.alpha = 0.5, .epsilon = 1e-4});
+		CHECK(scores.size() < 20);
+		CHECK(scores.at(0) == Approx(0.5));
+		CHECK(scores.at(1) == Approx(0.25));
+	}
+
+	SECTION("errors") {
+		CHECK(gdwg::personalised_pagerank(g, std::vector<int>{}).empty());
+		CHECK_THROWS_MATCHES(gdwg::personalised_pagerank(g, 7),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::personalised_pagerank if a seed node doesn't "
+		                                              "exist in the graph"));
+		CHECK_THROWS_MATCHES(gdwg::personalised_pagerank(g, 1, {.alpha = 0.0}),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::personalised_pagerank with alpha outside (0, "
+		                                              "1] or a non-positive epsilon"));
+		g.insert_edge(1, 4, -1);
+		CHECK_THROWS_MATCHES(gdwg::personalised_pagerank(g, 1, {.weighted = true}),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::personalised_pagerank on a graph with "
+		                                              "negative edge weights"));
+	}
+}
+
+TEST_CASE("batch connectivity queries") {
+	using graph = gdwg::graph<int, int>;
+	auto rng = std::mt19937{13};
+	auto pick = std::uniform_int_distribution<int>{0, 29};
+	auto g = graph{};
+	for (auto i = 0; i < 30; ++i) {
+		g.insert_node(i);
+	}
+	for (auto i = 0; i < 40; ++i) {
+		g.insert_edge(pick(rng), pick(rng), i % 3);
+	}
+	auto queries = std::vector<std::pair<int, int>>{};
+	for (auto i = 0; i < 500; ++i) {
+		queries.emplace_back(pick(rng), pick(rng));
+	}
+	const auto reaches = [&](int src, int dst) {
+		auto seen = std::set<int>{src};
+		auto stack = std::vector<int>{src};
+		while (not stack.empty()) {
+			const auto u = stack.back();
+			stack.pop_back();
+			for (const auto v : g.connections(u)) {
+				if (seen.insert(v).second) {
+					stack.push_back(v);
+				}
+			}
+		}
+		return seen.contains(dst);
+	};
+
+	SECTION("is_connected_batch") {
+		for (const auto threads : {std::size_t{1}, std::size_t{4}}) {
+			const auto answers = g.is_connected_batch(queries, threads);
+			REQUIRE(answers.size() == queries.size());
+			for (auto i = std::size_t{0}; i < queries.size(); ++i) {
+				CHECK(answers[i] == g.is_connected(queries[i].first, queries[i].second));
+			}
+		}
+		CHECK(g.is_connected_batch({}).empty());
+	}
+
+	SECTION("reaches_batch") {
+		for (const auto threads : {std::size_t{1}, std::size_t{4}}) {
+			const auto answers = gdwg::reaches_batch(g, queries, threads);
+			REQUIRE(answers.size() == queries.size());
+			for (auto i = std::size_t{0}; i < queries.size(); ++i) {
+				CHECK(answers[i] == reaches(queries[i].first, queries[i].second));
+			}
+		}
+	}
+
+	SECTION("missing nodes") {
+		const auto missing = std::vector<std::pair<int, int>>{{1, 2}, {3, 99}};
+		CHECK_THROWS_MATCHES(g.is_connected_batch(missing),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::is_connected_batch if src or dst "
+		                                              "node don't exist in the graph"));
+		CHECK_THROWS_MATCHES(gdwg::reaches_batch(g, missing),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::reaches_batch if src or dst node don't exist "
+		                                              "in the graph"));
+	}
+}
+
+TEST_CASE("concurrent graph") {
+	using graph = gdwg::graph<int, int>;
+	using concurrent = gdwg::concurrent_graph<int, int>;
+
+	SECTION("matches graph") {
+		auto rng = std::mt19937{21};
+		auto pick = std::uniform_int_distribution<int>{0, 14};
+		auto expected = graph{};
+		auto actual = concurrent(4);
+		// Runs the same operation on both, requiring the same result or the same exception.
+		const auto same = [](auto&& on_graph, auto&& on_concurrent) {
+			auto expected_error = std::string{};
+			auto actual_error = std::string{};
+			auto expected_result = false;
+			auto actual_result = false;
+			try {
+				expected_result = on_graph();
+			} catch (const std::runtime_error& e) {
+				expected_error = e.what();
+			}
+			try {
+				actual_result = on_concurrent();
+			} catch (const std::runtime_error& e) {
+				actual_error = e.what();
+			}
+			CHECK(expected_result == actual_result);
+			CHECK(expected_error.empty() == actual_error.empty());
+		};
+		for (auto step = 0; step < 600; ++step) {
+			const auto a = pick(rng);
+			const auto b = pick(rng);
+			const auto w = std::optional<int>{a % 3 == 0 ? std::nullopt : std::optional<int>{b % 2}};
+			switch (step % 8) {
+			case 0:
+			case 1: same([&] { return expected.insert_node(a); }, [&] { return actual.insert_node(a); }); break;
+			case 2:
+			case 3:
+			case 4:
+				same([&] { return expected.insert_edge(a, b, w); }, [&] { return actual.insert_edge(a, b, w); });
+				break;
+			case 5:
+				same([&] { return expected.erase_edge(a, b, w); }, [&] { return actual.erase_edge(a, b, w); });
+				break;
+			case 6:
+				if (step % 48 == 6) {
+					same([&] { return expected.erase_node(a); }, [&] { return actual.erase_node(a); });
+				}
+				else {
+					same([&] { return expected.replace_node(a, b + 15); },
+					     [&] { return actual.replace_node(a, b + 15); });
+				}
+				break;
+			default:
+				same([&] { return expected.merge_replace_node(a, b), true; },
+				     [&] { return actual.merge_replace_node(a, b), true; });
+				break;
+			}
+			same([&] { return expected.is_connected(a, b); }, [&] { return actual.is_connected(a, b); });
+			same([&] { return expected.connections(a) == std::vector<int>{b}; },
+			     [&] { return actual.connections(a) == std::vector<int>{b}; });
+		}
+		// graph's operator== also compares emptied edge sets that erase_node leaves behind, so compare printouts.
+		const auto print = [](const auto& g) {
+			auto out = std::ostringstream{};
+			out << g;
+			return out.str();
+		};
+		CHECK(print(actual.to_graph()) == print(expected));
+		CHECK(print(actual) == print(expected));
+		CHECK(actual.nodes() == expected.nodes());
+		CHECK(actual.empty() == expected.empty());
+		CHECK(print(concurrent(expected)) == print(expected));
+		actual.clear();
+		CHECK(actual.empty());
+	}
+
+	SECTION("edges") {
+		auto g = concurrent{1, 2};
+		g.insert_edge(1, 2, 5);
+		g.insert_edge(1, 2);
+		const auto edges = g.edges(1, 2);
+		REQUIRE(edges.size() == 2);
+		CHECK(edges[0]->print_edge() == "1 -> 2 | U");
+		CHECK(edges[1]->print_edge() == "1 -> 2 | W | 5");
+		CHECK_THROWS_MATCHES(g.insert_edge(1, 3),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::concurrent_graph<N, E>::insert_edge when "
+		                                              "either src or dst node does not exist"));
+	}
+
+	SECTION("parallel writers") {
+		auto g = concurrent(8);
+		constexpr auto nodes = 64;
+		for (auto i = 0; i < nodes; ++i) {
+			g.insert_node(i);
+		}
+		auto threads = std::vector<std::thread>{};
+		for (auto t = 0; t < 4; ++t) {
+			threads.emplace_back([&, t] {
+				for (auto i = 0; i < 2000; ++i) {
+					const auto src = (i * 7 + t) % nodes;
+					const auto dst = (i * 13 + t * 3) % nodes;
+					g.insert_edge(src, dst, i % 5);
+					static_cast<void>(g.is_connected(dst, src));
+					if (i % 10 == 0) {
+						g.erase_edge(src, dst, i % 5);
+					}
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		auto expected = graph{};
+		for (auto i = 0; i < nodes; ++i) {
+			expected.insert_node(i);
+		}
+		for (auto t = 0; t < 4; ++t) {
+			for (auto i = 0; i < 2000; ++i) {
+				expected.insert_edge((i * 7 + t) % nodes, (i * 13 + t * 3) % nodes, i % 5);
+			}
+		}
+		// Erased edges may have been re-inserted by another thread, so only check nothing unexpected appeared.
+		const auto actual = g.to_graph();
+		for (const auto& [src, dst, weight] : actual) {
+			CHECK(expected.find(src, dst, weight) != expected.end());
+		}
+	}
+}
+
+TEST_CASE("versioned graph snapshots") {
+	using graph = gdwg::graph<int, int>;
+	const auto print = [](const auto& g) {
+		auto out = std::ostringstream{};
+		out << g;
+		return out.str();
+	};
+
+	SECTION("matches graph") {
+		auto rng = std::mt19937{34};
+		auto pick = std::uniform_int_distribution<int>{0, 11};
+		auto expected = graph{};
+		auto actual = gdwg::versioned_graph<int, int>(8);
+		auto history = std::vector<std::pair<gdwg::graph_snapshot<int, int>, std::string>>{};
+		for (auto step = 0; step < 400; ++step) {
+			const auto a = pick(rng);
+			const auto b = pick(rng);
+			const auto w = std::optional<int>{b % 3};
+			// Runs the same operation on both, requiring the same result or both to throw.
+			const auto same = [](auto&& on_graph, auto&& on_versioned) {
+				auto expected_result = std::optional<bool>{};
+				auto actual_result = std::optional<bool>{};
+				try {
+					expected_result = on_graph();
+				} catch (const std::runtime_error&) {
+				}
+				try {
+					actual_result = on_versioned();
+				} catch (const std::runtime_error&) {
+				}
+				CHECK(expected_result == actual_result);
+			};
+			switch (step % 7) {
+			case 0: same([&] { return expected.insert_node(a); }, [&] { return actual.insert_node(a); }); break;
+			case 1:
+			case 2:
+			case 3:
+				same([&] { return expected.insert_edge(a, b, w); }, [&] { return actual.insert_edge(a, b, w); });
+				break;
+			case 4:
+				same([&] { return expected.erase_edge(a, b, w); }, [&] { return actual.erase_edge(a, b, w); });
+				break;
+			case 5:
+				if (step % 35 == 5) {
+					same([&] { return expected.erase_node(a); }, [&] { return actual.erase_node(a); });
+				}
+				else {
+					same([&] { return expected.replace_node(a, b + 12); },
+					     [&] { return actual.replace_node(a, b + 12); });
+				}
+				break;
+			default:
+				same([&] { return expected.merge_replace_node(a, b), true; },
+				     [&] { return actual.merge_replace_node(a, b), true; });
+				break;
+			}
+			const auto snapshot = actual.snapshot();
+			CHECK(print(snapshot) == print(expected));
+			CHECK(snapshot.nodes() == expected.nodes());
+			if (expected.is_node(a)) {
+				CHECK(snapshot.connections(a) == expected.connections(a));
+				if (expected.is_node(b)) {
+					CHECK(snapshot.is_connected(a, b) == expected.is_connected(a, b));
+					CHECK(snapshot.edges(a, b).size() == expected.edges(a, b).size());
+				}
+			}
+			if (step % 50 == 0) {
+				history.emplace_back(snapshot, print(expected));
+			}
+		}
+		// Old snapshots still show the graph as it was.
+		for (const auto& [snapshot, printed] : history) {
+			CHECK(print(snapshot) == printed);
+		}
+		actual.clear();
+		CHECK(actual.snapshot().empty());
+		CHECK(not history.back().first.empty());
+	}
+
+	SECTION("versions and reclamation") {
+		auto g = gdwg::versioned_graph<int, std::shared_ptr<int>>{1, 2};
+		const auto weight = std::make_shared<int>(7);
+		const auto before = g.snapshot();
+		CHECK(g.insert_edge(1, 2, weight));
+		CHECK(not g.insert_edge(1, 2, weight));
+		CHECK(g.snapshot().version() == before.version() + 1);
+		{
+			const auto held = g.snapshot();
+			CHECK(g.erase_edge(1, 2, weight));
+			CHECK(held.is_connected(1, 2));
+			CHECK(not g.snapshot().is_connected(1, 2));
+			CHECK(weight.use_count() > 1);
+		}
+		CHECK(weight.use_count() == 1);
+		CHECK(not before.is_connected(1, 2));
+		CHECK_THROWS_MATCHES(g.insert_edge(1, 3),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::versioned_graph<N, E>::insert_edge when "
+		                                              "either src or dst node does not exist"));
+	}
+
+	SECTION("readers during writes") {
+		auto g = gdwg::versioned_graph<int, int>{0};
+		auto done = std::atomic<bool>{false};
+		auto readers = std::vector<std::thread>{};
+		auto consistent = std::atomic<bool>{true};
+		for (auto r = 0; r < 3; ++r) {
+			readers.emplace_back([&] {
+				auto last = std::uint64_t{0};
+				while (not done.load()) {
+					// A snapshot never changes underneath its reader, and versions only move forwards.
+					const auto snapshot = g.snapshot();
+					const auto nodes = snapshot.nodes();
+					auto edges = std::size_t{0};
+					for (const auto node : nodes) {
+						edges += snapshot.connections(node).size();
+					}
+					auto again = std::size_t{0};
+					for (const auto node : snapshot.nodes()) {
+						again += snapshot.connections(node).size();
+					}
+					if (snapshot.nodes() != nodes or again != edges or snapshot.version() < last) {
+						consistent = false;
+					}
+					last = snapshot.version();
+				}
+			});
+		}
+		for (auto i = 1; i < 300; ++i) {
+			g.insert_node(i);
+			g.insert_edge(i, i - 1, i);
+			g.erase_node(i);
+			g.insert_node(i);
+			g.insert_edge(i, i - 1, i);
+		}
+		done = true;
+		for (auto& reader : readers) {
+			reader.join();
+		}
+		CHECK(consistent.load());
+	}
+}
+
+TEST_CASE("edge ingest") {
+	using graph = gdwg::graph<int, int>;
+	const auto print = [](const graph& g) {
+		auto out = std::ostringstream{};
+		out << g;
+		return out.str();
+	};
+	constexpr auto nodes = 40;
+	auto base = graph{};
+	for (auto i = 0; i < nodes; ++i) {
+		base.insert_node(i);
+	}
+	base.insert_edge(0, 1, 3);
+	base.insert_edge(5, 5);
+	const auto edge_of = [](int t, int i) {
+		return std::tuple{(i * 7 + t) % nodes, (i * 11) % nodes, i % 4 == 0 ? std::nullopt : std::optional<int>{i % 3}};
+	};
+
+	SECTION("parallel ingest matches serial inserts") {
+		auto ingest = gdwg::edge_ingest<int, int>(base);
+		auto threads = std::vector<std::thread>{};
+		for (auto t = 0; t < 4; ++t) {
+			threads.emplace_back([&, t] {
+				for (auto i = 0; i < 3000; ++i) {
+					const auto [src, dst, weight] = edge_of(t, i);
+					ingest.insert_edge(src, dst, weight);
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		auto expected = base;
+		for (auto t = 0; t < 4; ++t) {
+			for (auto i = 0; i < 3000; ++i) {
+				const auto [src, dst, weight] = edge_of(t, i);
+				expected.insert_edge(src, dst, weight);
+			}
+		}
+		const auto sealed = ingest.seal(2);
+		CHECK(print(sealed) == print(expected));
+		CHECK(sealed.is_connected(0, 1));
+		CHECK(sealed.find(5, 5) != sealed.end());
+
+		// The ingest keeps its nodes and starts again from no edges.
+		ingest.insert_edge(1, 2, 9);
+		const auto again = ingest.seal();
+		CHECK(again.nodes() == base.nodes());
+		CHECK(again.connections(1) == std::vector<int>{2});
+		CHECK(again.connections(0).empty());
+	}
+
+	SECTION("errors") {
+		auto ingest = gdwg::edge_ingest<int, int>{1, 2};
+		ingest.insert_edge(1, 2);
+		ingest.insert_edge(1, 2);
+		CHECK(ingest.seal().edges(1, 2).size() == 1);
+		CHECK_THROWS_MATCHES(ingest.insert_edge(1, 3),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::edge_ingest<N, E>::insert_edge when either "
+		                                              "src or dst node does not exist"));
+	}
+}
+
+TEST_CASE("parallel whole-graph operations") {
+	using graph = gdwg::graph<int, int>;
+	const auto print = [](const graph& g) {
+		auto out = std::ostringstream{};
+		out << g;
+		return out.str();
+	};
+	auto rng = std::mt19937{55};
+	auto pick = std::uniform_int_distribution<int>{0, 199};
+	auto g = graph{};
+	for (auto i = 0; i < 200; ++i) {
+		g.insert_node(i);
+	}
+	for (auto i = 0; i < 1500; ++i) {
+		const auto weight = i % 5 == 0 ? std::nullopt : std::optional<int>{i % 4};
+		g.insert_edge(pick(rng), pick(rng), weight);
+	}
+	const auto policy = gdwg::parallel_policy{.threads = 4};
+
+	SECTION("copy, compare and print") {
+		const auto copy = graph(policy, g);
+		CHECK(copy == g);
+		CHECK(copy.equals(policy, g));
+		CHECK(print(copy) == print(g));
+		auto out = std::ostringstream{};
+		g.print(out, policy);
+		CHECK(out.str() == print(g));
+		auto changed = graph(gdwg::par, g);
+		changed.erase_edge(changed.begin());
+		CHECK(not changed.equals(policy, g));
+		CHECK(not graph{1, 2}.equals(policy, graph{1, 3}));
+	}
+
+	SECTION("erase_node") {
+		auto serial = g;
+		auto parallel = graph(policy, g);
+		for (const auto node : {3, 50, 199, 7, 1000}) {
+			CHECK(parallel.erase_node(policy, node) == serial.erase_node(node));
+		}
+		CHECK(print(parallel) == print(serial));
+		CHECK(parallel == serial);
+		CHECK(parallel.equals(policy, serial));
+	}
+
+	SECTION("merge_replace_node") {
+		auto serial = g;
+		auto parallel = graph(policy, g);
+		for (const auto& [old_data, new_data] : std::vector<std::pair<int, int>>{{3, 4}, {10, 10}, {20, 5}, {4, 199}}) {
+			serial.merge_replace_node(old_data, new_data);
+			parallel.merge_replace_node(policy, old_data, new_data);
+		}
+		CHECK(print(parallel) == print(serial));
+		CHECK(parallel == serial);
+		CHECK_THROWS_MATCHES(parallel.merge_replace_node(policy, 3, 4),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::merge_replace_node on old or new "
+		                                              "data if they don't exist in the graph"));
+	}
+}
+
+TEST_CASE("work-stealing thread pool") {
+	auto pool = gdwg::thread_pool(3);
+	CHECK(pool.size() == 3);
+
+	SECTION("fork/join") {
+		// Recursive forking grows the workers' deques well past their initial size.
+		const auto sum = [&](const auto& self, int first, int last) -> long {
+			if (last - first <= 4) {
+				auto total = 0L;
+				for (auto i = first; i < last; ++i) {
+					total += i;
+				}
+				return total;
+			}
+			const auto middle = first + (last - first) / 2;
+			auto left = 0L;
+			auto group = gdwg::task_group(pool);
+			group.run([&] { left = self(self, first, middle); });
+			const auto right = self(self, middle, last);
+			group.wait();
+			return left + right;
+		};
+		CHECK(sum(sum, 0, 20000) == 199990000L);
+
+		auto group = gdwg::task_group(pool);
+		for (auto i = 0; i < 100; ++i) {
+			group.run([i] {
+				if (i == 42) {
+					throw std::runtime_error("task failed");
+				}
+			});
+		}
+		CHECK_THROWS_WITH(group.wait(), "task failed");
+	}
+
+	SECTION("a thread outside the pool sleeps while the tasks it waits for run") {
+		auto group = gdwg::task_group(pool);
+		auto done = std::atomic<int>{0};
+		for (auto i = 0; i < 3; ++i) {
+			group.run([&] {
+				std::this_thread::sleep_for(std::chrono::milliseconds(200));
+				++done;
+			});
+		}
+		// Give the workers time to take every task, so the waiting thread has nothing left to run.
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		const auto cpu = std::clock();
+		group.wait();
+		const auto seconds = static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC;
+		CHECK(done.load() == 3);
+		CHECK(seconds < 0.05);
+	}
+
+	SECTION("algorithms run on a scoped pool") {
+		auto g = gdwg::graph<int, int>{};
+		for (auto i = 0; i < 60; ++i) {
+			g.insert_node(i);
+		}
+		for (auto i = 0; i < 60; ++i) {
+			g.insert_edge(i, (i * 7 + 1) % 60, 1);
+			g.insert_edge(i, (i + 1) % 60, 2);
+		}
+		const auto serial = gdwg::betweenness_centrality(g, {.threads = 1});
+		auto parallel = std::map<int, double>{};
+		{
+			const auto scope = gdwg::pool_scope(pool);
+			parallel = gdwg::betweenness_centrality(g, {.threads = 4});
+			// Nested parallel loops on pool workers help rather than block.
+			auto hits = std::vector<std::atomic<int>>(64);
+			gdwg::detail::parallel_for(8, 4, [&](std::size_t, std::size_t i) {
+				gdwg::detail::parallel_for(8, 4, [&](std::size_t, std::size_t j) { ++hits[i * 8 + j]; });
+			});
+			CHECK(std::all_of(hits.begin(), hits.end(), [](const auto& hit) { return hit.load() == 1; }));
+		}
+		for (const auto& [node, value] : serial) {
+			CHECK(parallel.at(node) == Approx(value));
+		}
+		const auto copy = gdwg::graph<int, int>(gdwg::parallel_policy{.threads = 4, .pool = &pool}, g);
+		CHECK(copy == g);
+	}
+
+	SECTION("pinned workers") {
+		auto pinned = gdwg::thread_pool(2, true);
+		auto seen = std::vector<std::atomic<int>>(1000);
+		auto largest_worker = std::atomic<std::size_t>{0};
+		const auto scope = gdwg::pool_scope(pinned);
+		gdwg::detail::parallel_for(1000, 3, [&](std::size_t worker, std::size_t i) {
+			++seen[i];
+			for (auto largest = largest_worker.load(); worker > largest;) {
+				largest_worker.compare_exchange_weak(largest, worker);
+			}
+		});
+		CHECK(std::all_of(seen.begin(), seen.end(), [](const auto& hit) { return hit.load() == 1; }));
+		CHECK(largest_worker.load() < 3);
+	}
+}
+
+TEST_CASE("lazy traversal generators") {
+	auto g = gdwg::graph<std::string, int>{"a", "b", "c", "d", "e", "f"};
+	g.insert_edge("a", "c", 1);
+	g.insert_edge("a", "b", 2);
+	g.insert_edge("a", "b", 1);
+	g.insert_edge("b", "d", 1);
+	g.insert_edge("c", "e", 1);
+	g.insert_edge("d", "a", 1);
+	g.insert_edge("e", "e");
+
+	const auto collect = [](auto&& range) {
+		auto res = std::vector<std::string>{};
+		for (const auto& node : range) {
+			res.push_back(node);
+		}
+		return res;
+	};
+
+	SECTION("bfs and dfs order") {
+		CHECK(collect(g.bfs_range("a")) == std::vector<std::string>{"a", "b", "c", "d", "e"});
+		CHECK(collect(g.dfs_range("a")) == std::vector<std::string>{"a", "b", "d", "c", "e"});
+		CHECK(collect(g.bfs_range("f")) == std::vector<std::string>{"f"});
+		CHECK(collect(g.dfs_range("e")) == std::vector<std::string>{"e"});
+	}
+
+	SECTION("edges_from") {
+		auto edges = std::vector<std::string>{};
+		for (const auto& [from, to, weight] : g.edges_from("a")) {
+			edges.push_back(from + to + (weight ? std::to_string(*weight) : "U"));
+		}
+		CHECK(edges == std::vector<std::string>{"ab1", "ab2", "ac1"});
+		CHECK(collect(g.edges_from("f") | std::views::transform([](const auto& e) { return e.to; })).empty());
+	}
+
+	SECTION("early termination") {
+		auto chain = gdwg::graph<int, int>{};
+		for (auto i = 0; i < 5000; ++i) {
+			chain.insert_node(i);
+		}
+		for (auto i = 0; i + 1 < 5000; ++i) {
+			chain.insert_edge(i, i + 1, 1);
+		}
+		auto first = std::vector<int>{};
+		for (const auto node : chain.dfs_range(10) | std::views::take(3)) {
+			first.push_back(node);
+		}
+		CHECK(first == std::vector<int>{10, 11, 12});
+		auto found = std::optional<int>{};
+		for (const auto node : chain.bfs_range(0)) {
+			if (node % 7 == 6) {
+				found = node;
+				break;
+			}
+		}
+		CHECK(found == 6);
+	}
+
+	SECTION("errors") {
+		CHECK_THROWS_MATCHES(g.bfs_range("z"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::bfs_range if src doesn't "
+		                                              "exist in the graph"));
+		CHECK_THROWS_MATCHES(g.dfs_range("z"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::dfs_range if src doesn't "
+		                                              "exist in the graph"));
+		CHECK_THROWS_MATCHES(g.edges_from("z"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::edges_from if src doesn't "
+		                                              "exist in the graph"));
+	}
+}
+
+TEST_CASE("transactional batch mutation") {
+	using graph = gdwg::graph<int, int>;
+	const auto print = [](const auto& g) {
+		auto out = std::ostringstream{};
+		out << g;
+		return out.str();
+	};
+
+	SECTION("later operations see earlier node changes") {
+		auto g = graph{1, 2};
+		auto b = graph::batch{};
+		b.insert_node(3).insert_edge(1, 3, 5).insert_edge(3, 2).insert_edge(1, 3, 5);
+		b.replace_node(2, 4).insert_edge(4, 1);
+		b.erase_edge(1, 3, 5).erase_edge(1, 3, 6).insert_node(1).merge_replace_node(3, 1).merge_replace_node(1, 1);
+		CHECK(b.size() == 11);
+		const auto results = std::vector<bool>{true, true, true, false, true, true, true, false, false, true, false};
+		CHECK(g.apply_batch(b) == results);
+		auto expected = graph{1, 4};
+		expected.insert_edge(1, 4);
+		expected.insert_edge(4, 1);
+		CHECK(g == expected);
+		CHECK(graph{}.apply_batch(graph::batch{}).empty());
+	}
+
+	SECTION("a failing operation leaves the graph untouched") {
+		auto g = graph{1, 2, 3};
+		g.insert_edge(1, 2, 1);
+		const auto before = g;
+		auto b = graph::batch{};
+		b.insert_edge(2, 3).erase_node(1).erase_edge(1, 2, 1);
+		CHECK_THROWS_MATCHES(g.apply_batch(b),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::apply_batch when either src or "
+		                                              "dst node of an edge does not exist"));
+		CHECK(g == before);
+		b.clear();
+		CHECK(b.empty());
+		b.insert_node(7).replace_node(7, 8).replace_node(7, 9);
+		CHECK_THROWS_MATCHES(g.apply_batch(b),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::apply_batch to replace a node "
+		                                              "that doesn't exist"));
+		b.clear();
+		b.insert_edge(1, 3).merge_replace_node(1, 4);
+		CHECK_THROWS_MATCHES(g.apply_batch(b),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph<N, E>::apply_batch to merge nodes that "
+		                                              "don't exist"));
+		CHECK(g == before);
+	}
+
+	SECTION("matches the member calls applied one by one") {
+		auto rng = std::mt19937{47};
+		const auto pick = [&](int bound) { return std::uniform_int_distribution<int>(0, bound)(rng); };
+		for (auto round = 0; round < 200; ++round) {
+			auto g = graph{};
+			for (auto i = 0; i < 8; ++i) {
+				g.insert_node(i);
+			}
+			for (auto i = 0; i < 20; ++i) {
+				g.insert_edge(pick(7), pick(7), pick(2));
+			}
+			auto expected = g;
+			auto results = std::vector<bool>{};
+			auto throws = false;
+			auto b = graph::batch{};
+			for (auto i = 0; i < 40; ++i) {
+				const auto lhs = pick(9);
+				const auto rhs = pick(9);
+				const auto weight = pick(3) == 0 ? std::nullopt : std::optional<int>{pick(2)};
+				const auto kind = pick(19);
+				try {
+					if (kind < 8) {
+						b.insert_edge(lhs, rhs, weight);
+						results.push_back(expected.insert_edge(lhs, rhs, weight));
+					}
+					else if (kind < 15) {
+						b.erase_edge(lhs, rhs, weight);
+						results.push_back(expected.erase_edge(lhs, rhs, weight));
+					}
+					else if (kind < 16) {
+						b.insert_node(lhs);
+						results.push_back(expected.insert_node(lhs));
+					}
+					else if (kind < 17) {
+						b.erase_node(lhs);
+						results.push_back(expected.erase_node(lhs));
+					}
+					else if (kind < 18) {
+						b.replace_node(lhs, rhs);
+						results.push_back(expected.replace_node(lhs, rhs));
+					}
+					else {
+						b.merge_replace_node(lhs, rhs);
+						expected.merge_replace_node(lhs, rhs);
+						results.push_back(lhs != rhs);
+					}
+				} catch (const std::runtime_error&) {
+					throws = true;
+					break;
+				}
+			}
+			const auto before = g;
+			if (throws) {
+				CHECK_THROWS_AS(g.apply_batch(b), std::runtime_error);
+				CHECK(g == before);
+			}
+			else {
+				CHECK(g.apply_batch(b) == results);
+				CHECK(g == expected);
+				CHECK(print(g) == print(expected));
+			}
+		}
+	}
+}
+
+TEST_CASE("epoch-reclaimed graph") {
+	using graph = gdwg::epoch_graph<std::string, int>;
+	const auto print = [](const auto& g) {
+		auto out = std::ostringstream{};
+		out << g;
+		return out.str();
+	};
+
+	SECTION("modifiers match graph") {
+		auto g = graph{"a", "b", "c"};
+		auto expected = gdwg::graph<std::string, int>{"a", "b", "c"};
+		CHECK_FALSE(g.insert_node("a"));
+		CHECK(g.insert_edge("a", "b", 2));
+		CHECK(g.insert_edge("a", "b"));
+		CHECK(g.insert_edge("a", "c", 1));
+		CHECK_FALSE(g.insert_edge("a", "b", 2));
+		CHECK(g.insert_edge("c", "a", 3));
+		CHECK(g.insert_edge("b", "b", 4));
+		CHECK(g.erase_edge("b", "b", 4));
+		CHECK_FALSE(g.erase_edge("b", "b", 4));
+		CHECK(g.insert_node("d"));
+		CHECK(g.insert_edge("d", "c", 1));
+		CHECK(g.erase_node("c"));
+		CHECK_FALSE(g.erase_node("c"));
+		CHECK(g.insert_node("c"));
+		expected.insert_edge("a", "b", 2);
+		expected.insert_edge("a", "b");
+		expected.insert_node("d");
+		CHECK(g.to_graph() == expected);
+		CHECK(print(g) == print(expected));
+		CHECK_THROWS_MATCHES(g.insert_edge("a", "z"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::epoch_graph<N, E>::insert_edge when either "
+		                                              "src or dst node does not exist"));
+		CHECK_THROWS_MATCHES(g.erase_edge("z", "a"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::epoch_graph<N, E>::erase_edge on src or dst "
+		                                              "if they don't exist in the graph"));
+	}
+
+	SECTION("readers walk plain handles") {
+		auto g = graph{"a", "b", "c", "d"};
+		g.insert_edge("a", "c", 1);
+		g.insert_edge("a", "b", 5);
+		g.insert_edge("b", "d");
+		auto r = graph::reader(g);
+		auto guard = r.pin();
+		CHECK_FALSE(guard.find("z"));
+		CHECK(guard.is_node("d"));
+		const auto a = *guard.find("a");
+		const auto edges = guard.edges(a);
+		REQUIRE(edges.size() == 2);
+		CHECK(guard.value(edges[0].to) == "b");
+		CHECK(edges[0].weight == 5);
+		CHECK(guard.value(edges[1].to) == "c");
+		CHECK(guard.edges(*guard.find("d")).empty());
+		auto names = std::vector<std::string>{};
+		for (const auto node : guard.nodes()) {
+			names.push_back(guard.value(node));
+		}
+		CHECK(names == std::vector<std::string>{"a", "b", "c", "d"});
+	}
+
+	SECTION("a pinned reader defers reclamation") {
+		auto g = graph{"a", "b", "c"};
+		g.insert_edge("a", "b", 1);
+		g.collect();
+		CHECK(g.pending_reclamation() == 0);
+		auto r = graph::reader(g);
+		{
+			auto guard = r.pin();
+			const auto edges = guard.edges(*guard.find("a"));
+			const auto b = *guard.find("b");
+			g.insert_edge("a", "c", 2);
+			g.erase_node("b");
+			g.collect();
+			CHECK(g.pending_reclamation() > 0);
+			REQUIRE(edges.size() == 1);
+			CHECK(edges[0].weight == 1);
+			CHECK(guard.value(b) == "b");
+			CHECK_FALSE(guard.is_node("b"));
+		}
+		g.collect();
+		CHECK(g.pending_reclamation() == 0);
+		CHECK(g.insert_node("e"));
+		auto guard = r.pin();
+		CHECK(guard.value(*guard.find("e")) == "e");
+		CHECK(guard.edges(*guard.find("a")).size() == 1);
+	}
+
+	SECTION("concurrent readers and a writer") {
+		auto g = gdwg::epoch_graph<int, int>{};
+		for (auto i = 0; i < 32; ++i) {
+			g.insert_node(i);
+		}
+		auto done = std::atomic<bool>{false};
+		auto bad = std::atomic<int>{0};
+		auto readers = std::vector<std::thread>{};
+		for (auto t = 0; t < 2; ++t) {
+			readers.emplace_back([&] {
+				auto r = gdwg::epoch_graph<int, int>::reader(g);
+				while (not done.load()) {
+					auto guard = r.pin();
+					for (const auto node : guard.nodes()) {
+						const auto src = guard.value(node);
+						auto last = std::optional<std::pair<int, std::optional<int>>>{};
+						for (const auto& [to, weight] : guard.edges(node)) {
+							const auto entry = std::pair{guard.value(to), weight};
+							const auto ordered = not last or *last < entry;
+							if (entry.first < 0 or entry.first >= 64 or weight != src or not ordered) {
+								bad.fetch_add(1);
+							}
+							last = entry;
+						}
+					}
+				}
+			});
+		}
+		auto rng = std::mt19937{48};
+		auto present = std::set<int>{};
+		for (auto i = 0; i < 32; ++i) {
+			present.insert(i);
+		}
+		for (auto i = 0; i < 3000; ++i) {
+			const auto src = static_cast<int>(rng() % 64);
+			const auto dst = static_cast<int>(rng() % 64);
+			if (rng() % 8 == 0) {
+				g.erase_node(src);
+				g.insert_node(src);
+				present.insert(src);
+			}
+			else if (present.contains(src) and present.contains(dst)) {
+				g.insert_edge(src, dst, src);
+				if (rng() % 2 == 0) {
+					g.erase_edge(src, dst, src);
+				}
+			}
+			else {
+				g.insert_node(dst);
+				present.insert(dst);
+			}
+		}
+		done.store(true);
+		for (auto& reader : readers) {
+			reader.join();
+		}
+		CHECK(bad.load() == 0);
+		g.collect();
+		CHECK(g.pending_reclamation() == 0);
+	}
+}
+
+TEST_CASE("partitioned graph") {
+	using partitioned = gdwg::partitioned_graph<int, int>;
+	auto g = gdwg::graph<int, int>{};
+	for (auto i = 0; i < 60; ++i) {
+		g.insert_node(i);
+	}
+	auto rng = std::mt19937{49};
+	for (auto i = 0; i < 200; ++i) {
+		const auto weight = rng() % 3 == 0 ? std::nullopt : std::optional<int>{static_cast<int>(rng() % 4)};
+		g.insert_edge(static_cast<int>(rng() % 60), static_cast<int>(rng() % 60), weight);
+	}
+	const auto print = [](const auto& graph) {
+		auto out = std::ostringstream{};
+		out << graph;
+		return out.str();
+	};
+	const auto by_residue = [](int value) { return static_cast<std::size_t>(value % 3); };
+
+	SECTION("matches the source graph") {
+		const auto parts = partitioned(g, by_residue, {.partitions = 3});
+		REQUIRE(parts.partitions() == 3);
+		CHECK(parts.partition_at(1).nodes.front() == 1);
+		CHECK(parts.partition_at(1).offsets.size() == parts.partition_at(1).nodes.size() + 1);
+		CHECK(print(parts) == print(g));
+		CHECK_FALSE(parts.empty());
+		CHECK_FALSE(parts.is_node(60));
+		CHECK(parts.value(*parts.find(58)) == 58);
+		for (auto src = 0; src < 60; src += 7) {
+			CHECK(parts.connections(src) == g.connections(src));
+			for (auto dst = 0; dst < 60; dst += 5) {
+				CHECK(parts.is_connected(src, dst) == g.is_connected(src, dst));
+			}
+			CHECK(parts.hop_counts(src) == gdwg::hop_counts(g, {src}).at(src));
+		}
+		CHECK_THROWS_MATCHES(parts.connections(60),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::partitioned_graph<N, E>::connections if src "
+		                                              "doesn't exist in the graph"));
+	}
+
+	SECTION("hash partitions and placements") {
+		for (const auto memory : {gdwg::placement::local, gdwg::placement::interleaved}) {
+			const auto parts = partitioned(g, {.partitions = 4, .memory = memory});
+			CHECK(parts.partitions() == 4);
+			CHECK(print(parts) == print(g));
+			CHECK(parts.hop_counts(0) == gdwg::hop_counts(g, {0}).at(0));
+		}
+		const auto single = partitioned(g);
+		CHECK(single.partitions() >= 1);
+		CHECK(print(single) == print(g));
+		CHECK(partitioned(gdwg::graph<int, int>{}).empty());
+	}
+
+	SECTION("per-partition work") {
+		const auto parts = partitioned(g, by_residue, {.partitions = 3});
+		auto edges = std::array<std::size_t, 3>{};
+		parts.for_each_partition([&](std::size_t p) { edges[p] = parts.partition_at(p).targets.size(); });
+		CHECK(edges[0] + edges[1] + edges[2] == static_cast<std::size_t>(std::distance(g.begin(), g.end())));
+		CHECK_THROWS_AS(parts.for_each_partition([](std::size_t p) {
+			if (p == 2) {
+				throw std::logic_error("partition failed");
+			}
+		}),
+		                std::logic_error);
+		CHECK_THROWS_MATCHES(partitioned(g, by_residue, {.partitions = 2}),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot construct gdwg::partitioned_graph<N, E> with a "
+		                                              "partitioner that returns a partition out of range"));
+	}
+}
+
+TEST_CASE("binary snapshots") {
+	using view_type = gdwg::graph_view<std::string, int>;
+	using wrong_type = gdwg::graph_view<int, int>;
+	using layout = gdwg::detail::binary_layout;
+	const auto path = (std::filesystem::temp_directory_path() / "gdwg_graph_binary_test.bin").string();
+	const auto print = [](const auto& g) {
+		auto out = std::ostringstream{};
+		out << g;
+		return out.str();
+	};
+	// Reads a u64 header field of the saved file, and corrupts the file by overwriting the value at byte at.
+	const auto header = [&](std::size_t field) {
+		auto file = std::ifstream(path, std::ios::binary);
+		auto bytes = std::array<char, 8>{};
+		file.seekg(static_cast<std::streamoff>(field));
+		file.read(bytes.data(), bytes.size());
+		return gdwg::detail::load_little<std::uint64_t>(bytes.data());
+	};
+	const auto overwrite = [&](std::uint64_t at, auto value) {
+		auto file = std::fstream(path, std::ios::in | std::ios::out | std::ios::binary);
+		const auto bytes = gdwg::detail::store_little(value);
+		file.seekp(static_cast<std::streamoff>(at));
+		file.write(bytes.data(), bytes.size());
+	};
+	const auto not_a_graph = Catch::Matchers::Message("Cannot call gdwg::graph_view<N, E>::open_mmap if the file is "
+	                                                  "not a gdwg binary graph");
+
+	SECTION("string nodes round trip") {
+		auto g = gdwg::graph<std::string, int>{"how", "are", "you?", "", "lonely"};
+		g.insert_edge("how", "you?", 1);
+		g.insert_edge("how", "you?", -3);
+		g.insert_edge("how", "you?");
+		g.insert_edge("how", "are", 5);
+		g.insert_edge("you?", "", 2);
+		g.insert_edge("are", "are");
+		g.save_binary(path);
+		const auto view = view_type::open_mmap(path);
+		CHECK(view.node_count() == 5);
+		CHECK(view.edge_count() == 6);
+		CHECK(view.node(0).empty());
+		CHECK(view.nodes() == g.nodes());
+		CHECK(print(view) == print(g));
+		CHECK(view.to_graph() == g);
+		CHECK(view.is_node("lonely"));
+		CHECK_FALSE(view.is_node("hello"));
+		CHECK(view.is_connected("how", "you?"));
+		CHECK_FALSE(view.is_connected("you?", "how"));
+		CHECK(view.connections("how") == g.connections("how"));
+		const auto edges = view.edges("how", "you?");
+		REQUIRE(edges.size() == 3);
+		CHECK(edges[0]->print_edge() == "how -> you? | U");
+		CHECK(edges[1]->print_edge() == "how -> you? | W | -3");
+		CHECK(edges[2]->print_edge() == "how -> you? | W | 1");
+		CHECK_THROWS_MATCHES(view.connections("hello"),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph_view<N, E>::connections if src doesn't "
+		                                              "exist in the graph"));
+	}
+
+	SECTION("numeric nodes, string weights and moves") {
+		auto g = gdwg::graph<int, std::string>{};
+		for (auto i = 0; i < 300; ++i) {
+			g.insert_node(i * 7 - 1000);
+		}
+		for (auto i = 0; i < 300; ++i) {
+			g.insert_edge(i * 7 - 1000, (i * 13 % 300) * 7 - 1000, std::to_string(i));
+			g.insert_edge(i * 7 - 1000, (i * 31 % 300) * 7 - 1000);
+		}
+		g.save_binary(path);
+		auto view = gdwg::graph_view<int, std::string>::open_mmap(path);
+		auto moved = std::move(view);
+		CHECK(print(moved) == print(g));
+		CHECK(moved.is_connected(-1000 + 7, -1000 + 13 * 7));
+		view = gdwg::graph_view<int, std::string>::open_mmap(path);
+		CHECK(view.to_graph() == g);
+
+		gdwg::graph<double, double>{}.save_binary(path);
+		const auto empty = gdwg::graph_view<double, double>::open_mmap(path);
+		CHECK(empty.empty());
+		CHECK(print(empty).empty());
+	}
+
+	SECTION("queries check what they read from a corrupt file") {
+		const auto save = [&] {
+			auto g = gdwg::graph<std::string, int>{"a", "bc"};
+			g.insert_edge("a", "bc", 1);
+			g.save_binary(path);
+		};
+		save();
+		// The only edge's target is past the last node.
+		overwrite(header(layout::targets_at), std::uint32_t{7});
+		{
+			const auto view = view_type::open_mmap(path);
+			CHECK_THROWS_MATCHES(view.connections("a"), std::runtime_error, not_a_graph);
+			CHECK_THROWS_MATCHES(view.to_graph(), std::runtime_error, not_a_graph);
+		}
+		save();
+		// Node "a"'s edges end past the last edge.
+		overwrite(header(layout::offsets_at) + sizeof(std::uint64_t), std::uint64_t{5});
+		{
+			const auto view = view_type::open_mmap(path);
+			CHECK_THROWS_MATCHES(view.connections("a"), std::runtime_error, not_a_graph);
+			CHECK_THROWS_MATCHES(print(view), std::runtime_error, not_a_graph);
+		}
+		save();
+		// Node "a"'s characters end past the node column's characters.
+		overwrite(header(layout::nodes_at) + sizeof(std::uint64_t), std::uint64_t{9});
+		{
+			const auto view = view_type::open_mmap(path);
+			CHECK_THROWS_MATCHES(view.nodes(), std::runtime_error, not_a_graph);
+			CHECK_THROWS_MATCHES(view.is_node("bc"), std::runtime_error, not_a_graph);
+		}
+	}
+
+	SECTION("rejects other files") {
+		gdwg::graph<std::string, int>{"a"}.save_binary(path);
+		CHECK_THROWS_MATCHES(wrong_type::open_mmap(path),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph_view<N, E>::open_mmap if the file was "
+		                                              "saved with different node or weight types"));
+		// A character count so large that adding the fixed part of the column wraps it around to a small size.
+		overwrite(header(layout::nodes_at) + sizeof(std::uint64_t), std::uint64_t{0} - 8);
+		CHECK_THROWS_MATCHES(view_type::open_mmap(path), std::runtime_error, not_a_graph);
+		std::filesystem::resize_file(path, 100);
+		CHECK_THROWS_MATCHES(view_type::open_mmap(path), std::runtime_error, not_a_graph);
+		std::ofstream(path) << "gdwg graph, but as text\n";
+		CHECK_THROWS_MATCHES(view_type::open_mmap(path), std::runtime_error, not_a_graph);
+		std::filesystem::remove(path);
+		CHECK_THROWS_MATCHES(view_type::open_mmap(path),
+		                     std::runtime_error,
+		                     Catch::Matchers::Message("Cannot call gdwg::graph_view<N, E>::open_mmap if the file "
+		                                              "cannot be opened"));
+	}
+	std::filesystem::remove(path);
+}